@@ -0,0 +1,55 @@
+// Loop time of a firmware on the host. Every iteration advances the mock clock by the given
+// number of microseconds and runs the sketch's loop() once, so modules which are due do their work.
+
+#include <benchmark/benchmark.h>
+
+#include "Arduino.h"
+#include "mock_hal.h"
+#include "rosserial_host.h"
+
+namespace
+{
+
+pet::mock::RosserialHost& connected_firmware()
+{
+    static pet::mock::RosserialHost host;
+    static const bool started = [] {
+        pet::mock::reset();
+        for (std::uint8_t pin = 0; pin < pet::mock::kNumPins; ++pin) {
+            pet::mock::set_echo_distance(pin, 0.5);
+        }
+        setup();
+        host.connect();
+        for (int i = 0; i < 100; ++i)
+        {
+            pet::mock::advance_millis(1);
+            loop();
+        }
+        // Only the firmware's side is measured.
+        host.set_recording(false);
+        host.clear_publications();
+        return true;
+    }();
+    static_cast<void>(started);
+    return host;
+}
+
+void BM_loop(benchmark::State& state)
+{
+    auto& host = connected_firmware();
+    const auto step = static_cast<unsigned long>(state.range(0));
+
+    for (auto _ : state)
+    {
+        pet::mock::advance_micros(step);
+        pet::mock::run_ping_timer();
+        loop();
+    }
+
+    state.counters["topics"] = static_cast<double>(host.topics().size());
+}
+BENCHMARK(BM_loop)->Arg(100)->Arg(1000)->Arg(10000);
+
+} // namespace
+
+BENCHMARK_MAIN();
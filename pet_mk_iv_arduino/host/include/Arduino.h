@@ -0,0 +1,87 @@
+#ifndef PET_MOCK_ARDUINO_H
+#define PET_MOCK_ARDUINO_H
+
+// Host replacement of the Arduino core for an ATmega328P board (Uno, Nano), so that firmware
+// modules build and run on a workstation. Pins and time are simulated, see mock_hal.h for how
+// tests drive them.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "HardwareSerial.h"
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))
+
+#define PROGMEM
+#define F(string_literal) (string_literal)
+
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+
+using byte = std::uint8_t;
+using boolean = bool;
+using word = std::uint16_t;
+
+constexpr std::uint8_t A0 = 14;
+constexpr std::uint8_t A1 = 15;
+constexpr std::uint8_t A2 = 16;
+constexpr std::uint8_t A3 = 17;
+constexpr std::uint8_t A4 = 18;
+constexpr std::uint8_t A5 = 19;
+constexpr std::uint8_t A6 = 20;
+constexpr std::uint8_t A7 = 21;
+
+constexpr std::uint8_t LED_BUILTIN = 13;
+
+void pinMode(std::uint8_t pin, std::uint8_t mode);
+void digitalWrite(std::uint8_t pin, std::uint8_t value);
+int digitalRead(std::uint8_t pin);
+int analogRead(std::uint8_t pin);
+void analogWrite(std::uint8_t pin, int value);
+
+unsigned long pulseIn(std::uint8_t pin, std::uint8_t state, unsigned long timeout = 1000000L);
+
+// 32 bits wide as on the ATmega328P, so that they wrap around at the same times.
+std::uint32_t millis();
+std::uint32_t micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void attachInterrupt(std::uint8_t interrupt, void (*isr)(), int mode);
+void detachInterrupt(std::uint8_t interrupt);
+inline void interrupts() {}
+inline void noInterrupts() {}
+
+inline long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+template<typename T>
+constexpr T constrain(T x, T low, T high)
+{
+    return (x < low) ? low : ((x > high) ? high : x);
+}
+
+// Sketch entry points, defined by the firmware.
+void setup();
+void loop();
+
+#endif // PET_MOCK_ARDUINO_H
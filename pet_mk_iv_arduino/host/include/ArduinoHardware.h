@@ -0,0 +1,42 @@
+#ifndef ROS_ARDUINO_HARDWARE_H_
+#define ROS_ARDUINO_HARDWARE_H_
+
+#include <cstdint>
+
+#include "Arduino.h"
+
+// Host version of rosserial_arduino's hardware layer. Same interface, on the mock Serial and
+// clock, so that ros::NodeHandle talks to pet::mock::RosserialHost instead of rosserial_python.
+class ArduinoHardware
+{
+public:
+    ArduinoHardware(HardwareSerial* io, long baud = 57600)
+        : m_iostream(io)
+        , m_baud(baud)
+    {
+    }
+
+    ArduinoHardware()
+        : ArduinoHardware(&Serial)
+    {
+    }
+
+    void setBaud(long baud) { m_baud = baud; }
+    int getBaud() { return static_cast<int>(m_baud); }
+
+    HardwareSerial* getPort() { return m_iostream; }
+    void setPort(HardwareSerial* io) { m_iostream = io; }
+
+    void init() { m_iostream->begin(static_cast<unsigned long>(m_baud)); }
+
+    int read() { return m_iostream->read(); }
+    void write(std::uint8_t* data, int length) { m_iostream->write(data, static_cast<std::size_t>(length)); }
+
+    std::uint32_t time() { return millis(); }
+
+private:
+    HardwareSerial* m_iostream;
+    long m_baud;
+};
+
+#endif // ROS_ARDUINO_HARDWARE_H_
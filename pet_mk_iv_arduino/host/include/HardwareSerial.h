@@ -0,0 +1,53 @@
+#ifndef PET_MOCK_HARDWARE_SERIAL_H
+#define PET_MOCK_HARDWARE_SERIAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+// Serial port of the mock Arduino core. What the firmware writes goes to a listener on the other
+// end of the line, typically pet::mock::RosserialHost; what the other end sends is queued for
+// the firmware to read.
+class HardwareSerial
+{
+public:
+    using Listener = std::function<void(const std::uint8_t* data, std::size_t size)>;
+
+public:
+    void begin(unsigned long baud) { m_baud = baud; }
+    void end() {}
+
+    int available() const { return static_cast<int>(m_received.size()); }
+    int peek() const { return m_received.empty() ? -1 : m_received.front(); }
+    int read();
+
+    std::size_t write(std::uint8_t byte) { return write(&byte, 1); }
+    std::size_t write(const std::uint8_t* data, std::size_t size);
+    void flush() {}
+
+    std::size_t print(const char* string);
+    std::size_t print(long value);
+    std::size_t print(double value, int digits = 2);
+    std::size_t println(const char* string = "");
+    std::size_t println(long value);
+    std::size_t println(double value, int digits = 2);
+
+    explicit operator bool() const { return true; }
+
+    // Other end of the line, not part of the Arduino API.
+    unsigned long baud() const { return m_baud; }
+    void set_listener(Listener listener) { m_listener = std::move(listener); }
+    void receive(const std::uint8_t* data, std::size_t size);
+    void clear();
+
+private:
+    unsigned long m_baud = 0;
+    std::deque<std::uint8_t> m_received;
+    Listener m_listener;
+};
+
+extern HardwareSerial Serial;
+
+#endif // PET_MOCK_HARDWARE_SERIAL_H
@@ -0,0 +1,50 @@
+#ifndef PET_MOCK_IR_REMOTE_H
+#define PET_MOCK_IR_REMOTE_H
+
+// Mock of the receiving part of the IRremote library (2.x API). Codes are queued per pin with
+// pet::mock::send_ir_code().
+
+enum decode_type_t
+{
+    UNKNOWN = -1,
+    UNUSED  = 0,
+    RC5,
+    RC6,
+    NEC,
+    SONY,
+};
+
+#define REPEAT 0xFFFFFFFF
+
+struct decode_results
+{
+    decode_type_t decode_type = UNKNOWN;
+    unsigned int address = 0;
+    unsigned long value = 0;
+    int bits = 0;
+    volatile unsigned int* rawbuf = nullptr;
+    int rawlen = 0;
+    int overflow = 0;
+};
+
+class IRrecv
+{
+public:
+    explicit IRrecv(int recvpin) : m_pin(recvpin) {}
+    IRrecv(int recvpin, int /*blinkpin*/) : m_pin(recvpin) {}
+
+    void enableIRIn() { m_enabled = true; }
+    void blink13(int /*blinkflag*/) {}
+
+    // A decoded code is held until resume().
+    int decode(decode_results* results);
+    void resume() { m_holding = false; }
+    bool isIdle() const { return !m_holding; }
+
+private:
+    int m_pin;
+    bool m_enabled = false;
+    bool m_holding = false;
+};
+
+#endif // PET_MOCK_IR_REMOTE_H
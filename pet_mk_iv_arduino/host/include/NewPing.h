@@ -0,0 +1,45 @@
+#ifndef PET_MOCK_NEW_PING_H
+#define PET_MOCK_NEW_PING_H
+
+#include <cstdint>
+
+// Mock of the NewPing ultrasonic sensor library, whose real implementation drives the AVR
+// registers directly. Echo times are set per trigger pin with pet::mock::set_echo_time().
+
+#define MAX_SENSOR_DISTANCE 500
+#define US_ROUNDTRIP_CM 57
+#define US_ROUNDTRIP_IN 146
+#define NO_ECHO 0
+
+class NewPing
+{
+public:
+    NewPing(std::uint8_t trigger_pin, std::uint8_t echo_pin, unsigned int max_cm_distance = MAX_SENSOR_DISTANCE);
+
+    // Echo time [us], NO_ECHO beyond the maximum distance.
+    unsigned int ping(unsigned int max_cm_distance = 0);
+    unsigned long ping_cm(unsigned int max_cm_distance = 0);
+    unsigned long ping_in(unsigned int max_cm_distance = 0);
+    unsigned long ping_median(std::uint8_t it = 5, unsigned int max_cm_distance = 0);
+
+    static unsigned int convert_cm(unsigned int echo_time);
+    static unsigned int convert_in(unsigned int echo_time);
+
+    // Timer based pinging. The echo arrives right away: user_func is called once, during which
+    // check_timer() returns true and ping_result holds the echo time.
+    void ping_timer(void (*user_func)(), unsigned int max_cm_distance = 0);
+    bool check_timer();
+
+    static void timer_us(unsigned int frequency, void (*user_func)());
+    static void timer_ms(unsigned long frequency, void (*user_func)());
+    static void timer_stop();
+
+    unsigned long ping_result = 0;
+
+private:
+    std::uint8_t m_trigger_pin;
+    unsigned int m_max_cm_distance;
+    bool m_echo_pending = false;
+};
+
+#endif // PET_MOCK_NEW_PING_H
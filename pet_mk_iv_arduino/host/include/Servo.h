@@ -0,0 +1,35 @@
+#ifndef PET_MOCK_SERVO_H
+#define PET_MOCK_SERVO_H
+
+#include <cstdint>
+
+// Mock of the Arduino Servo library. The pulse width of every attached servo is kept for tests,
+// see pet::mock::servo_pulse_width().
+class Servo
+{
+public:
+    static constexpr int kMinPulseWidth = 544;
+    static constexpr int kMaxPulseWidth = 2400;
+    static constexpr int kDefaultPulseWidth = 1500;
+
+public:
+    std::uint8_t attach(int pin);
+    std::uint8_t attach(int pin, int min, int max);
+    void detach();
+
+    // Values below the minimum pulse width are angles [deg], others pulse widths [us].
+    void write(int value);
+    void writeMicroseconds(int value);
+
+    int read() const;
+    int readMicroseconds() const { return m_pulse_width; }
+    bool attached() const { return m_pin >= 0; }
+
+private:
+    int m_pin = -1;
+    int m_min = kMinPulseWidth;
+    int m_max = kMaxPulseWidth;
+    int m_pulse_width = kDefaultPulseWidth;
+};
+
+#endif // PET_MOCK_SERVO_H
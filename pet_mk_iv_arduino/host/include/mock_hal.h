@@ -0,0 +1,48 @@
+#ifndef PET_MOCK_HAL_H
+#define PET_MOCK_HAL_H
+
+#include <cstdint>
+
+// Test side of the mock Arduino HAL: sets what the firmware reads and inspects what it wrote.
+// Time only moves when told to, or when the firmware delays.
+
+namespace pet::mock
+{
+
+// Digital pins 0-13 and analog pins A0-A7 (14-21) of an ATmega328P board.
+constexpr int kNumPins = 22;
+
+// Back to power-on: time zero, all pins inputs at LOW, no interrupts, servos, echoes or ir codes.
+void reset();
+
+void advance_micros(unsigned long us);
+void advance_millis(unsigned long ms);
+
+// Level of an input pin. Changing it runs the interrupt attached to the pin, if its mode matches.
+void set_digital_input(std::uint8_t pin, int level);
+// Raw 10 bit value of an analog pin.
+void set_analog_input(std::uint8_t pin, int value);
+// Pulse length returned by pulseIn() on a pin [us], 0 for a timeout.
+void set_pulse_width(std::uint8_t pin, unsigned long us);
+
+int pin_mode(std::uint8_t pin);
+int digital_output(std::uint8_t pin);
+// Duty cycle written by analogWrite() [0, 255].
+int analog_output(std::uint8_t pin);
+
+// Round trip time of the echo seen by a NewPing sensor on the trigger pin [us], 0 for no echo.
+void set_echo_time(std::uint8_t trigger_pin, unsigned int us);
+// Same, given as the distance to the obstacle [m].
+void set_echo_distance(std::uint8_t trigger_pin, double distance);
+// Runs the function given to NewPing::timer_us()/timer_ms(), as its timer interrupt would.
+void run_ping_timer();
+
+// Pulse width of the servo attached to a pin [us], 0 if none is attached.
+int servo_pulse_width(std::uint8_t pin);
+
+// Queues a code for the IRrecv on a pin to decode.
+void send_ir_code(std::uint8_t pin, unsigned long value, int decode_type = 3, int bits = 32);
+
+} // namespace pet::mock
+
+#endif // PET_MOCK_HAL_H
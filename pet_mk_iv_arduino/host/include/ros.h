@@ -0,0 +1,15 @@
+#ifndef _ROS_H_
+#define _ROS_H_
+
+// Takes the place of rosserial_arduino's ros.h in host builds. The rest of ros_lib is used as is.
+
+#include "ros/node_handle.h"
+#include "ArduinoHardware.h"
+
+namespace ros
+{
+// Buffer sizes rosserial_arduino uses on the ATmega328P of the Uno and Nano.
+typedef NodeHandle_<ArduinoHardware, 25, 25, 280, 280> NodeHandle;
+}
+
+#endif // _ROS_H_
@@ -0,0 +1,126 @@
+#ifndef PET_MOCK_ROSSERIAL_HOST_H
+#define PET_MOCK_ROSSERIAL_HOST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "HardwareSerial.h"
+
+namespace pet::mock
+{
+
+// The ROS side of the serial line in place of rosserial_python: asks the firmware's NodeHandle
+// for its topics, answers its time requests and records everything it publishes. Messages are
+// (de)serialised with the ros_lib message types the firmware uses.
+class RosserialHost
+{
+public:
+    struct Topic
+    {
+        std::uint16_t id = 0;
+        std::string name;
+        std::string message_type;
+        bool publisher = false;
+    };
+
+    struct Publication
+    {
+        std::uint32_t stamp;    // Mock time of arrival [ms].
+        std::vector<std::uint8_t> payload;
+    };
+
+public:
+    explicit RosserialHost(HardwareSerial& serial = Serial);
+    ~RosserialHost();
+
+    RosserialHost(const RosserialHost&) = delete;
+    RosserialHost& operator=(const RosserialHost&) = delete;
+
+    // Requests the topics, the way rosserial_python starts a session. The firmware answers on
+    // its next spinOnce().
+    void connect();
+
+    // The firmware has announced its topics since the latest connect().
+    bool connected() const { return !m_topics.empty(); }
+
+    const std::map<std::string, Topic>& topics() const { return m_topics; }
+    const std::vector<Publication>& publications(const std::string& topic) const;
+    const std::vector<std::string>& logs() const { return m_logs; }
+    void clear_publications();
+
+    // Publications and logs are only kept while recording, which is the default. Benchmarks turn
+    // it off so that the host's bookkeeping does not grow inside the timed loop.
+    void set_recording(bool recording) { m_recording = recording; }
+
+    // Latest message published on a topic, false if there is none.
+    template<typename Message>
+    bool latest(const std::string& topic, Message& message) const;
+
+    // Sends a message to a subscriber of the firmware, false if it subscribes to no such topic.
+    template<typename Message>
+    bool send(const std::string& topic, const Message& message);
+
+private:
+    void on_transmit(const std::uint8_t* data, std::size_t size);
+    void on_frame(std::uint16_t topic_id, const std::uint8_t* payload, std::size_t size);
+    void send_frame(std::uint16_t topic_id, const std::uint8_t* payload, std::size_t size);
+    void send_time();
+
+private:
+    // Reserved topic ids of rosserial_msgs/TopicInfo.
+    static constexpr std::uint16_t kIdPublisher = 0;
+    static constexpr std::uint16_t kIdSubscriber = 1;
+    static constexpr std::uint16_t kIdLog = 7;
+    static constexpr std::uint16_t kIdTime = 10;
+
+    // Larger than any input buffer the firmware can have.
+    static constexpr std::size_t kMaxMessageSize = 1024;
+
+    static constexpr std::uint8_t kSync = 0xff;
+    static constexpr std::uint8_t kProtocolVersion = 0xfe;
+
+    HardwareSerial& m_serial;
+
+    // Frame being received.
+    std::vector<std::uint8_t> m_frame;
+
+    std::map<std::string, Topic> m_topics;
+    std::map<std::uint16_t, std::string> m_topic_names;
+    std::map<std::string, std::vector<Publication>> m_publications;
+    std::vector<std::string> m_logs;
+    bool m_recording = true;
+};
+
+template<typename Message>
+bool RosserialHost::latest(const std::string& topic, Message& message) const
+{
+    const auto& received = publications(topic);
+    if (received.empty()) {
+        return false;
+    }
+    // ros_lib deserialises from a mutable buffer.
+    std::vector<std::uint8_t> buffer = received.back().payload;
+    message.deserialize(buffer.data());
+    return true;
+}
+
+template<typename Message>
+bool RosserialHost::send(const std::string& topic, const Message& message)
+{
+    const auto it = m_topics.find(topic);
+    if (it == m_topics.end() || it->second.publisher) {
+        return false;
+    }
+    // ros_lib messages can not tell their size before serialising.
+    std::uint8_t buffer[kMaxMessageSize];
+    const int size = message.serialize(buffer);
+    send_frame(it->second.id, buffer, static_cast<std::size_t>(size));
+    return true;
+}
+
+} // namespace pet::mock
+
+#endif // PET_MOCK_ROSSERIAL_HOST_H
@@ -0,0 +1,267 @@
+#include "Arduino.h"
+
+#include <cstdio>
+
+#include "mock_hal.h"
+#include "mock_state.h"
+
+HardwareSerial Serial;
+
+namespace pet::mock
+{
+
+namespace
+{
+
+constexpr int kInterruptPins[] = {2, 3};
+
+void run_interrupt(int pin, int previous, int level)
+{
+    auto& s = state();
+    for (std::size_t interrupt = 0; interrupt < s.isr.size(); ++interrupt)
+    {
+        if (kInterruptPins[interrupt] != pin || s.isr[interrupt] == nullptr) {
+            continue;
+        }
+        const int mode = s.isr_mode[interrupt];
+        const bool triggered = (mode == CHANGE)
+                            || (mode == RISING && previous == LOW && level == HIGH)
+                            || (mode == FALLING && previous == HIGH && level == LOW);
+        if (triggered) {
+            s.isr[interrupt]();
+        }
+    }
+}
+
+} // namespace
+
+State& state()
+{
+    static State s;
+    return s;
+}
+
+void advance(std::uint64_t us)
+{
+    auto& s = state();
+    const std::uint64_t total = s.millis_remainder + us;
+    s.micros += static_cast<std::uint32_t>(us);
+    s.millis += static_cast<std::uint32_t>(total / 1000);
+    s.millis_remainder = static_cast<std::uint32_t>(total % 1000);
+}
+
+void reset()
+{
+    state() = State{};
+    Serial.clear();
+}
+
+void advance_micros(unsigned long us)
+{
+    advance(us);
+}
+
+void advance_millis(unsigned long ms)
+{
+    advance(static_cast<std::uint64_t>(ms) * 1000);
+}
+
+void set_digital_input(std::uint8_t pin, int level)
+{
+    if (!valid_pin(pin)) {
+        return;
+    }
+    const int previous = state().level[pin];
+    state().level[pin] = level;
+    if (level != previous) {
+        run_interrupt(pin, previous, level);
+    }
+}
+
+void set_analog_input(std::uint8_t pin, int value)
+{
+    if (valid_pin(pin)) {
+        state().analog_input[pin] = constrain(value, 0, 1023);
+    }
+}
+
+void set_pulse_width(std::uint8_t pin, unsigned long us)
+{
+    if (valid_pin(pin)) {
+        state().pulse_width[pin] = us;
+    }
+}
+
+int pin_mode(std::uint8_t pin)
+{
+    return valid_pin(pin) ? state().mode[pin] : INPUT;
+}
+
+int digital_output(std::uint8_t pin)
+{
+    return valid_pin(pin) ? state().level[pin] : LOW;
+}
+
+int analog_output(std::uint8_t pin)
+{
+    return valid_pin(pin) ? state().analog_output[pin] : 0;
+}
+
+} // namespace pet::mock
+
+using pet::mock::advance;
+using pet::mock::state;
+using pet::mock::valid_pin;
+
+void pinMode(std::uint8_t pin, std::uint8_t mode)
+{
+    if (!valid_pin(pin)) {
+        return;
+    }
+    state().mode[pin] = mode;
+    // A pulled up input reads HIGH until driven low.
+    if (mode == INPUT_PULLUP) {
+        state().level[pin] = HIGH;
+    }
+}
+
+void digitalWrite(std::uint8_t pin, std::uint8_t value)
+{
+    if (valid_pin(pin)) {
+        state().level[pin] = value ? HIGH : LOW;
+    }
+}
+
+int digitalRead(std::uint8_t pin)
+{
+    return valid_pin(pin) ? state().level[pin] : LOW;
+}
+
+int analogRead(std::uint8_t pin)
+{
+    // Both A0 and 0 name the first analog input.
+    const int index = (pin < A0) ? pin + A0 : pin;
+    return valid_pin(index) ? state().analog_input[index] : 0;
+}
+
+void analogWrite(std::uint8_t pin, int value)
+{
+    if (!valid_pin(pin)) {
+        return;
+    }
+    state().analog_output[pin] = constrain(value, 0, 255);
+    state().level[pin] = (value >= 128) ? HIGH : LOW;
+}
+
+unsigned long pulseIn(std::uint8_t pin, std::uint8_t /*state*/, unsigned long timeout)
+{
+    if (!valid_pin(pin)) {
+        return 0;
+    }
+    const unsigned long width = state().pulse_width[pin];
+    if (width == 0 || width > timeout)
+    {
+        advance(timeout);
+        return 0;
+    }
+    advance(width);
+    return width;
+}
+
+std::uint32_t millis()
+{
+    return state().millis;
+}
+
+std::uint32_t micros()
+{
+    return state().micros;
+}
+
+void delay(unsigned long ms)
+{
+    advance(static_cast<std::uint64_t>(ms) * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    advance(us);
+}
+
+void attachInterrupt(std::uint8_t interrupt, void (*isr)(), int mode)
+{
+    if (interrupt < state().isr.size())
+    {
+        state().isr[interrupt] = isr;
+        state().isr_mode[interrupt] = mode;
+    }
+}
+
+void detachInterrupt(std::uint8_t interrupt)
+{
+    if (interrupt < state().isr.size()) {
+        state().isr[interrupt] = nullptr;
+    }
+}
+
+int HardwareSerial::read()
+{
+    if (m_received.empty()) {
+        return -1;
+    }
+    const int byte = m_received.front();
+    m_received.pop_front();
+    return byte;
+}
+
+std::size_t HardwareSerial::write(const std::uint8_t* data, std::size_t size)
+{
+    if (m_listener) {
+        m_listener(data, size);
+    }
+    return size;
+}
+
+std::size_t HardwareSerial::print(const char* string)
+{
+    return write(reinterpret_cast<const std::uint8_t*>(string), std::strlen(string));
+}
+
+std::size_t HardwareSerial::print(long value)
+{
+    char buffer[24];
+    std::snprintf(buffer, sizeof(buffer), "%ld", value);
+    return print(buffer);
+}
+
+std::size_t HardwareSerial::print(double value, int digits)
+{
+    char buffer[48];
+    std::snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return print(buffer);
+}
+
+std::size_t HardwareSerial::println(const char* string)
+{
+    return print(string) + print("\r\n");
+}
+
+std::size_t HardwareSerial::println(long value)
+{
+    return print(value) + print("\r\n");
+}
+
+std::size_t HardwareSerial::println(double value, int digits)
+{
+    return print(value, digits) + print("\r\n");
+}
+
+void HardwareSerial::receive(const std::uint8_t* data, std::size_t size)
+{
+    m_received.insert(m_received.end(), data, data + size);
+}
+
+void HardwareSerial::clear()
+{
+    m_received.clear();
+}
@@ -0,0 +1,187 @@
+#include <cmath>
+
+#include "Arduino.h"
+#include "IRremote.h"
+#include "NewPing.h"
+#include "Servo.h"
+
+#include "mock_hal.h"
+#include "mock_state.h"
+
+namespace pet::mock
+{
+
+void set_echo_time(std::uint8_t trigger_pin, unsigned int us)
+{
+    if (valid_pin(trigger_pin)) {
+        state().echo_time[trigger_pin] = us;
+    }
+}
+
+void set_echo_distance(std::uint8_t trigger_pin, double distance)
+{
+    // Round trip at the speed of sound in air.
+    constexpr double kSpeedOfSound = 343.0;
+    set_echo_time(trigger_pin, static_cast<unsigned int>(std::lround(2.0 * distance / kSpeedOfSound * 1e6)));
+}
+
+void run_ping_timer()
+{
+    if (state().ping_timer != nullptr) {
+        state().ping_timer();
+    }
+}
+
+int servo_pulse_width(std::uint8_t pin)
+{
+    return valid_pin(pin) ? state().servo_pulse_width[pin] : 0;
+}
+
+void send_ir_code(std::uint8_t pin, unsigned long value, int decode_type, int bits)
+{
+    if (!valid_pin(pin)) {
+        return;
+    }
+    decode_results code;
+    code.decode_type = static_cast<decode_type_t>(decode_type);
+    code.value = value;
+    code.bits = bits;
+    state().ir_codes[pin].push_back(code);
+}
+
+} // namespace pet::mock
+
+using pet::mock::state;
+using pet::mock::valid_pin;
+
+std::uint8_t Servo::attach(int pin)
+{
+    return attach(pin, kMinPulseWidth, kMaxPulseWidth);
+}
+
+std::uint8_t Servo::attach(int pin, int min, int max)
+{
+    if (!valid_pin(pin)) {
+        return 0;
+    }
+    m_pin = pin;
+    m_min = min;
+    m_max = max;
+    pinMode(static_cast<std::uint8_t>(pin), OUTPUT);
+    state().servo_pulse_width[pin] = m_pulse_width;
+    return static_cast<std::uint8_t>(pin);
+}
+
+void Servo::detach()
+{
+    if (attached()) {
+        state().servo_pulse_width[m_pin] = 0;
+    }
+    m_pin = -1;
+}
+
+void Servo::write(int value)
+{
+    if (value < kMinPulseWidth)
+    {
+        value = static_cast<int>(map(constrain(value, 0, 180), 0, 180, m_min, m_max));
+    }
+    writeMicroseconds(value);
+}
+
+void Servo::writeMicroseconds(int value)
+{
+    m_pulse_width = constrain(value, m_min, m_max);
+    if (attached()) {
+        state().servo_pulse_width[m_pin] = m_pulse_width;
+    }
+}
+
+int Servo::read() const
+{
+    return static_cast<int>(map(m_pulse_width + 1, m_min, m_max, 0, 180));
+}
+
+NewPing::NewPing(std::uint8_t trigger_pin, std::uint8_t /*echo_pin*/, unsigned int max_cm_distance)
+    : m_trigger_pin(trigger_pin)
+    , m_max_cm_distance(max_cm_distance)
+{
+}
+
+unsigned int NewPing::ping(unsigned int max_cm_distance)
+{
+    const unsigned int max_cm = (max_cm_distance > 0) ? max_cm_distance : m_max_cm_distance;
+    const unsigned int echo_time = valid_pin(m_trigger_pin) ? state().echo_time[m_trigger_pin] : 0;
+    return (echo_time > max_cm * US_ROUNDTRIP_CM) ? NO_ECHO : echo_time;
+}
+
+unsigned long NewPing::ping_cm(unsigned int max_cm_distance)
+{
+    return convert_cm(ping(max_cm_distance));
+}
+
+unsigned long NewPing::ping_in(unsigned int max_cm_distance)
+{
+    return convert_in(ping(max_cm_distance));
+}
+
+unsigned long NewPing::ping_median(std::uint8_t /*it*/, unsigned int max_cm_distance)
+{
+    // Every ping of the mock sees the same echo.
+    return ping(max_cm_distance);
+}
+
+unsigned int NewPing::convert_cm(unsigned int echo_time)
+{
+    return (echo_time + US_ROUNDTRIP_CM / 2) / US_ROUNDTRIP_CM;
+}
+
+unsigned int NewPing::convert_in(unsigned int echo_time)
+{
+    return (echo_time + US_ROUNDTRIP_IN / 2) / US_ROUNDTRIP_IN;
+}
+
+void NewPing::ping_timer(void (*user_func)(), unsigned int max_cm_distance)
+{
+    const unsigned int echo_time = ping(max_cm_distance);
+    if (echo_time == NO_ECHO) {
+        return;
+    }
+    ping_result = echo_time;
+    m_echo_pending = true;
+    if (user_func != nullptr) {
+        user_func();
+    }
+    m_echo_pending = false;
+}
+
+bool NewPing::check_timer()
+{
+    return m_echo_pending;
+}
+
+void NewPing::timer_us(unsigned int /*frequency*/, void (*user_func)())
+{
+    state().ping_timer = user_func;
+}
+
+void NewPing::timer_ms(unsigned long /*frequency*/, void (*user_func)())
+{
+    state().ping_timer = user_func;
+}
+
+void NewPing::timer_stop()
+{
+    state().ping_timer = nullptr;
+}
+
+int IRrecv::decode(decode_results* results)
+{
+    if (!m_enabled || m_holding || !valid_pin(m_pin) || state().ir_codes[m_pin].empty()) {
+        return 0;
+    }
+    *results = state().ir_codes[m_pin].front();
+    state().ir_codes[m_pin].pop_front();
+    m_holding = true;
+    return 1;
+}
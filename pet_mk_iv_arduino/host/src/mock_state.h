@@ -0,0 +1,52 @@
+#ifndef PET_MOCK_STATE_H
+#define PET_MOCK_STATE_H
+
+#include <array>
+#include <cstdint>
+#include <deque>
+
+#include "IRremote.h"
+#include "mock_hal.h"
+
+namespace pet::mock
+{
+
+// Everything the mock HAL simulates, shared by the core and the library mocks.
+struct State
+{
+    // Both wrap around like on the ATmega328P, where unsigned long is 32 bits: micros() after
+    // about 71 minutes and millis() after about 50 days.
+    std::uint32_t micros = 0;
+    std::uint32_t millis = 0;
+    // Microseconds since millis last ticked.
+    std::uint32_t millis_remainder = 0;
+
+    std::array<int, kNumPins> mode{};
+    std::array<int, kNumPins> level{};
+    std::array<int, kNumPins> analog_input{};
+    std::array<int, kNumPins> analog_output{};
+    std::array<unsigned long, kNumPins> pulse_width{};
+    std::array<unsigned int, kNumPins> echo_time{};
+    std::array<int, kNumPins> servo_pulse_width{};
+    std::array<std::deque<decode_results>, kNumPins> ir_codes{};
+
+    // Indexed by interrupt number, see digitalPinToInterrupt.
+    std::array<void (*)(), 2> isr{};
+    std::array<int, 2> isr_mode{};
+
+    void (*ping_timer)() = nullptr;
+};
+
+State& state();
+
+// Moves both clocks forward.
+void advance(std::uint64_t us);
+
+inline bool valid_pin(int pin)
+{
+    return pin >= 0 && pin < kNumPins;
+}
+
+} // namespace pet::mock
+
+#endif // PET_MOCK_STATE_H
@@ -0,0 +1,185 @@
+#include "rosserial_host.h"
+
+#include "Arduino.h"
+
+namespace pet::mock
+{
+
+namespace
+{
+
+// Fixed part of a frame: sync, protocol version, length (2), length checksum, topic id (2), and the
+// checksum after the payload.
+constexpr std::size_t kHeaderSize = 7;
+
+std::uint8_t checksum(const std::uint8_t* data, std::size_t size)
+{
+    unsigned sum = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        sum += data[i];
+    }
+    return static_cast<std::uint8_t>(255 - sum % 256);
+}
+
+// Reads the fields of rosserial_msgs/TopicInfo which identify a topic.
+bool parse_topic_info(const std::uint8_t* payload, std::size_t size, std::uint16_t& id, std::string& name, std::string& type)
+{
+    std::size_t offset = 0;
+    const auto read_string = [&](std::string& string) {
+        if (offset + 4 > size) {
+            return false;
+        }
+        const std::uint32_t length = payload[offset] | (payload[offset + 1] << 8) | (payload[offset + 2] << 16) | (static_cast<std::uint32_t>(payload[offset + 3]) << 24);
+        offset += 4;
+        if (offset + length > size) {
+            return false;
+        }
+        string.assign(payload + offset, payload + offset + length);
+        offset += length;
+        return true;
+    };
+
+    if (size < 2) {
+        return false;
+    }
+    id = static_cast<std::uint16_t>(payload[0] | (payload[1] << 8));
+    offset = 2;
+    return read_string(name) && read_string(type);
+}
+
+} // namespace
+
+RosserialHost::RosserialHost(HardwareSerial& serial)
+    : m_serial(serial)
+{
+    m_serial.set_listener([this](const std::uint8_t* data, std::size_t size) { on_transmit(data, size); });
+}
+
+RosserialHost::~RosserialHost()
+{
+    m_serial.set_listener(nullptr);
+}
+
+void RosserialHost::connect()
+{
+    m_topics.clear();
+    m_topic_names.clear();
+    send_frame(kIdPublisher, nullptr, 0);
+}
+
+const std::vector<RosserialHost::Publication>& RosserialHost::publications(const std::string& topic) const
+{
+    static const std::vector<Publication> kNone;
+    const auto it = m_publications.find(topic);
+    return (it != m_publications.end()) ? it->second : kNone;
+}
+
+void RosserialHost::clear_publications()
+{
+    m_publications.clear();
+    m_logs.clear();
+}
+
+void RosserialHost::on_transmit(const std::uint8_t* data, std::size_t size)
+{
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        const std::uint8_t byte = data[i];
+
+        // Resynchronise on anything that does not start like a frame.
+        if ((m_frame.empty() && byte != kSync) || (m_frame.size() == 1 && byte != kProtocolVersion))
+        {
+            m_frame.clear();
+            continue;
+        }
+        m_frame.push_back(byte);
+
+        if (m_frame.size() == 5 && checksum(&m_frame[2], 3) != 0)
+        {
+            m_frame.clear();
+            continue;
+        }
+        if (m_frame.size() < kHeaderSize) {
+            continue;
+        }
+
+        const std::size_t length = m_frame[2] | (m_frame[3] << 8);
+        if (m_frame.size() < kHeaderSize + length + 1) {
+            continue;
+        }
+
+        // The checksum covers topic id and payload, and sums to 255 with them.
+        if (checksum(&m_frame[5], length + 3) == 0)
+        {
+            const auto topic_id = static_cast<std::uint16_t>(m_frame[5] | (m_frame[6] << 8));
+            on_frame(topic_id, m_frame.data() + kHeaderSize, length);
+        }
+        m_frame.clear();
+    }
+}
+
+void RosserialHost::on_frame(std::uint16_t topic_id, const std::uint8_t* payload, std::size_t size)
+{
+    if (topic_id == kIdPublisher || topic_id == kIdSubscriber)
+    {
+        Topic topic;
+        topic.publisher = (topic_id == kIdPublisher);
+        if (parse_topic_info(payload, size, topic.id, topic.name, topic.message_type))
+        {
+            m_topic_names[topic.id] = topic.name;
+            m_topics[topic.name] = topic;
+        }
+    }
+    else if (topic_id == kIdTime)
+    {
+        send_time();
+    }
+    else if (!m_recording)
+    {
+        return;
+    }
+    else if (topic_id == kIdLog)
+    {
+        // rosserial_msgs/Log: level, then the message as a string.
+        if (size > 5) {
+            m_logs.emplace_back(payload + 5, payload + size);
+        }
+    }
+    else if (const auto it = m_topic_names.find(topic_id); it != m_topic_names.end())
+    {
+        m_publications[it->second].push_back(Publication{millis(), std::vector<std::uint8_t>(payload, payload + size)});
+    }
+}
+
+void RosserialHost::send_frame(std::uint16_t topic_id, const std::uint8_t* payload, std::size_t size)
+{
+    std::vector<std::uint8_t> frame;
+    frame.reserve(kHeaderSize + size + 1);
+    frame.push_back(kSync);
+    frame.push_back(kProtocolVersion);
+    frame.push_back(static_cast<std::uint8_t>(size & 0xff));
+    frame.push_back(static_cast<std::uint8_t>(size >> 8));
+    frame.push_back(checksum(&frame[2], 2));
+    frame.push_back(static_cast<std::uint8_t>(topic_id & 0xff));
+    frame.push_back(static_cast<std::uint8_t>(topic_id >> 8));
+    frame.insert(frame.end(), payload, payload + size);
+    frame.push_back(checksum(&frame[5], size + 2));
+    m_serial.receive(frame.data(), frame.size());
+}
+
+void RosserialHost::send_time()
+{
+    // std_msgs/Time on the mock clock, from millis() as the firmware's NodeHandle keeps time.
+    const std::uint32_t ms = millis();
+    const std::uint32_t fields[2] = {ms / 1000, ms % 1000 * 1000000};
+    std::uint8_t payload[8];
+    for (int field = 0; field < 2; ++field)
+    {
+        for (int byte = 0; byte < 4; ++byte) {
+            payload[field * 4 + byte] = static_cast<std::uint8_t>(fields[field] >> (8 * byte));
+        }
+    }
+    send_frame(kIdTime, payload, sizeof(payload));
+}
+
+} // namespace pet::mock
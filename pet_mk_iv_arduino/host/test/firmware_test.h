@@ -0,0 +1,69 @@
+#ifndef PET_MK_IV_ARDUINO_FIRMWARE_TEST_H
+#define PET_MK_IV_ARDUINO_FIRMWARE_TEST_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "Arduino.h"
+#include "mock_hal.h"
+#include "rosserial_host.h"
+
+namespace pet
+{
+
+// Runs the firmware's sketch against the mock HAL. The modules are static objects of
+// configure_modules(), so setup() runs once for all tests of a firmware.
+class FirmwareTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestCase()
+    {
+        mock::reset();
+        s_host = std::make_unique<mock::RosserialHost>();
+        setup();
+        s_host->connect();
+        run_for(100);
+    }
+
+    static void TearDownTestCase()
+    {
+        s_host.reset();
+    }
+
+    // Loops the sketch with time advancing one millisecond at a time.
+    static void run_for(unsigned long ms)
+    {
+        for (unsigned long i = 0; i < ms; ++i)
+        {
+            mock::advance_millis(1);
+            mock::run_ping_timer();
+            loop();
+        }
+    }
+
+    static std::size_t published_count()
+    {
+        std::size_t count = 0;
+        for (const auto& [name, topic] : s_host->topics())
+        {
+            if (topic.publisher) {
+                count += s_host->publications(name).size();
+            }
+        }
+        return count;
+    }
+
+    static bool has_topic(const std::string& name)
+    {
+        return s_host->topics().count(name) > 0;
+    }
+
+    static inline std::unique_ptr<mock::RosserialHost> s_host;
+};
+
+} // namespace pet
+
+#endif // PET_MK_IV_ARDUINO_FIRMWARE_TEST_H
@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+
+#include "IRremote.h"
+#include "firmware_test.h"
+
+namespace pet
+{
+namespace
+{
+
+using NanoTest = FirmwareTest;
+
+// IR receiver pin of configure_modules().
+constexpr std::uint8_t kIrReceiverPin = 11;
+
+TEST_F(NanoTest, AnnouncesTopics)
+{
+    ASSERT_TRUE(s_host->connected());
+    EXPECT_FALSE(s_host->topics().empty());
+}
+
+TEST_F(NanoTest, PublishesIrCodes)
+{
+    s_host->clear_publications();
+    run_for(100);
+    const std::size_t idle_count = published_count();
+
+    // OK key of a NEC remote.
+    mock::send_ir_code(kIrReceiverPin, 0xFF02FD, NEC);
+    run_for(100);
+
+    EXPECT_GT(published_count(), idle_count);
+}
+
+} // namespace
+} // namespace pet
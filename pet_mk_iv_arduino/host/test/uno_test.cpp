@@ -0,0 +1,108 @@
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include <gtest/gtest.h>
+
+#include "firmware_test.h"
+
+namespace pet
+{
+namespace
+{
+
+class UnoTest : public FirmwareTest
+{
+protected:
+    // Range messages of all sonars published over one second.
+    static std::size_t range_count_over_one_second()
+    {
+        s_host->clear_publications();
+        run_for(1000);
+        std::size_t count = 0;
+        for (const char* topic : {"range_sensor/left", "range_sensor/middle", "range_sensor/right"}) {
+            count += s_host->publications(topic).size();
+        }
+        return count;
+    }
+};
+
+TEST_F(UnoTest, AnnouncesTopicsOfAllModules)
+{
+    ASSERT_TRUE(s_host->connected());
+
+    for (const char* topic : {"range_sensor/left", "range_sensor/middle", "range_sensor/right",
+                              "line_sensor/left", "line_sensor/middle", "line_sensor/right"})
+    {
+        EXPECT_TRUE(has_topic(topic)) << topic;
+    }
+}
+
+TEST_F(UnoTest, PublishesRanges)
+{
+    for (const auto pin : {A0, A1, A2}) {
+        mock::set_echo_distance(pin, 0.5);
+    }
+    s_host->clear_publications();
+    run_for(1000);
+
+    for (const char* topic : {"range_sensor/left", "range_sensor/middle", "range_sensor/right"}) {
+        EXPECT_FALSE(s_host->publications(topic).empty()) << topic;
+    }
+}
+
+TEST_F(UnoTest, PublishesLineSensors)
+{
+    s_host->clear_publications();
+    for (int i = 0; i < 10; ++i)
+    {
+        for (const int pin : {2, 3, 4}) {
+            mock::set_digital_input(static_cast<std::uint8_t>(pin), i % 2 ? HIGH : LOW);
+        }
+        run_for(100);
+    }
+
+    for (const char* topic : {"line_sensor/left", "line_sensor/middle", "line_sensor/right"}) {
+        EXPECT_FALSE(s_host->publications(topic).empty()) << topic;
+    }
+}
+
+// Last, since they move the clock of the whole suite ahead by up to 50 days. Across a wraparound,
+// as many ranges must be published as in any other second, give or take one per sonar.
+TEST_F(UnoTest, KeepsPublishingAcrossMicrosWraparound)
+{
+    for (const auto pin : {A0, A1, A2}) {
+        mock::set_echo_distance(pin, 0.5);
+    }
+    const std::size_t expected = range_count_over_one_second();
+    ASSERT_GT(expected, 0u);
+
+    // Half a second before micros() wraps, after some time to settle from the jump.
+    mock::advance_micros(std::numeric_limits<std::uint32_t>::max() - micros() - 600000UL);
+    run_for(100);
+
+    const std::uint32_t before = micros();
+    const std::size_t count = range_count_over_one_second();
+    EXPECT_LT(micros(), before);
+    EXPECT_GE(count + 3, expected);
+}
+
+TEST_F(UnoTest, KeepsPublishingAcrossMillisWraparound)
+{
+    for (const auto pin : {A0, A1, A2}) {
+        mock::set_echo_distance(pin, 0.5);
+    }
+    const std::size_t expected = range_count_over_one_second();
+    ASSERT_GT(expected, 0u);
+
+    mock::advance_millis(std::numeric_limits<std::uint32_t>::max() - millis() - 600UL);
+    run_for(100);
+
+    const std::uint32_t before = millis();
+    const std::size_t count = range_count_over_one_second();
+    EXPECT_LT(millis(), before);
+    EXPECT_GE(count + 3, expected);
+}
+
+} // namespace
+} // namespace pet
@@ -0,0 +1,230 @@
+// Microbenchmarks of the KalmanFilter kernels. Results can be written as JSON with
+//
+//   kalman_filter_bench --benchmark_out=results.json --benchmark_out_format=json
+//
+// or with run_kalman_filter_bench.sh, which names the file after commit and architecture.
+// Predictions and jacobians take dt in milliseconds and heading in degrees as arguments,
+// updates take only the heading and batches the number of imu samples.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <ugl/math/vector.h>
+
+#include "kalman_filter.h"
+#include "kalman_filter_jacobians.h"
+
+namespace pet
+{
+
+namespace
+{
+
+constexpr double kDegToRad = M_PI / 180.0;
+
+// dt [ms] at and around the imu rate, and headings [deg] covering all quadrants.
+void dt_heading_args(benchmark::internal::Benchmark* benchmark)
+{
+    for (const int dt : {1, 10, 50})
+    {
+        for (const int heading : {0, 45, 90, 180, 270}) {
+            benchmark->Args({dt, heading});
+        }
+    }
+}
+
+double dt_arg(const benchmark::State& state)
+{
+    return state.range(0) * 1e-3;
+}
+
+double heading_arg(const benchmark::State& state)
+{
+    return state.range(1) * kDegToRad;
+}
+
+double update_heading_arg(const benchmark::State& state)
+{
+    return state.range(0) * kDegToRad;
+}
+
+ugl::Vector<5> state_vector(double heading)
+{
+    ugl::Vector<5> X;
+    X << heading, 0.2, 0.01, 1.0, -0.5;
+    return X;
+}
+
+void BM_predict(benchmark::State& state)
+{
+    const double dt = dt_arg(state);
+    KalmanFilter filter{heading_arg(state), ugl::Vector<2>::Zero(), ugl::Vector<2>::Zero()};
+    const ugl::Vector3 acc{0.0, 0.0, 9.81};
+    const ugl::Vector3 rate{0.0, 0.0, 0.01};
+
+    for (auto _ : state)
+    {
+        filter.predict(dt, acc, rate);
+        benchmark::DoNotOptimize(filter);
+    }
+}
+BENCHMARK(BM_predict)->Apply(dt_heading_args);
+
+void BM_command_predict(benchmark::State& state)
+{
+    const double dt = dt_arg(state);
+    KalmanFilter filter{heading_arg(state), ugl::Vector<2>::Zero(), ugl::Vector<2>::Zero()};
+
+    for (auto _ : state)
+    {
+        filter.command_predict(dt, 0.2, 0.01);
+        benchmark::DoNotOptimize(filter);
+    }
+}
+BENCHMARK(BM_command_predict)->Apply(dt_heading_args);
+
+void BM_sonar_velocity_update(benchmark::State& state)
+{
+    KalmanFilter filter{update_heading_arg(state), ugl::Vector<2>::Zero(), ugl::Vector<2>{0.2, 0.0}};
+
+    for (auto _ : state)
+    {
+        filter.sonar_velocity_update(0.2);
+        benchmark::DoNotOptimize(filter);
+    }
+}
+BENCHMARK(BM_sonar_velocity_update)->Arg(0)->Arg(90);
+
+template<int n>
+void BM_sonar_velocity_update_n(benchmark::State& state)
+{
+    KalmanFilter filter{update_heading_arg(state), ugl::Vector<2>::Zero(), ugl::Vector<2>{0.2, 0.0}};
+    const ugl::Vector<n> velocities = ugl::Vector<n>::Constant(0.2);
+    const ugl::Vector<n> directions = ugl::Vector<n>::LinSpaced(-0.5, 0.5);
+
+    for (auto _ : state)
+    {
+        filter.sonar_velocity_update<n>(velocities, directions);
+        benchmark::DoNotOptimize(filter);
+    }
+}
+BENCHMARK_TEMPLATE(BM_sonar_velocity_update_n, 1)->Arg(0);
+BENCHMARK_TEMPLATE(BM_sonar_velocity_update_n, 2)->Arg(0);
+BENCHMARK_TEMPLATE(BM_sonar_velocity_update_n, 3)->Arg(0);
+
+void BM_pseudo_lateral_velocity_update(benchmark::State& state)
+{
+    KalmanFilter filter{update_heading_arg(state), ugl::Vector<2>::Zero(), ugl::Vector<2>{0.2, 0.0}};
+
+    for (auto _ : state)
+    {
+        filter.pseudo_lateral_velocity_update(0.0);
+        benchmark::DoNotOptimize(filter);
+    }
+}
+BENCHMARK(BM_pseudo_lateral_velocity_update)->Arg(0)->Arg(90);
+
+// The update done every timer call of the node: all sonars and the lateral pseudo-observation stacked.
+void BM_fused_velocity_update(benchmark::State& state)
+{
+    KalmanFilter filter{update_heading_arg(state), ugl::Vector<2>::Zero(), ugl::Vector<2>{0.2, 0.0}};
+    const ugl::Vector<3> velocities = ugl::Vector<3>::Constant(0.2);
+    const ugl::Vector<3> directions{-0.5, 0.0, 0.5};
+
+    for (auto _ : state)
+    {
+        filter.update(KalmanFilter::sonar_velocity_observation<3>(velocities, directions),
+                      KalmanFilter::pseudo_lateral_velocity_observation(0.0));
+        benchmark::DoNotOptimize(filter);
+    }
+}
+BENCHMARK(BM_fused_velocity_update)->Arg(0);
+
+// A batch of imu samples at 100 Hz with a sonar observation every tenth sample, as in replay.
+void BM_process_batch(benchmark::State& state)
+{
+    const auto size = static_cast<std::size_t>(state.range(0));
+    std::vector<double> stamps(size);
+    std::vector<double> zeros(size, 0.0);
+    std::vector<double> gravity(size, 9.81);
+    std::vector<double> rate(size, 0.01);
+    for (std::size_t i = 0; i < size; ++i) {
+        stamps[i] = 0.01 * static_cast<double>(i + 1);
+    }
+    std::vector<std::size_t> sonar_index;
+    for (std::size_t i = 10; i <= size; i += 10) {
+        sonar_index.push_back(i);
+    }
+    const std::vector<double> sonar_velocity(sonar_index.size(), 0.2);
+
+    const KalmanFilter::ImuBatch imu{size, stamps.data(), zeros.data(), zeros.data(), gravity.data(), zeros.data(), zeros.data(), rate.data()};
+    const KalmanFilter::SonarBatch sonar{sonar_index.size(), sonar_index.data(), sonar_velocity.data(), nullptr};
+    std::vector<double> states(5 * size);
+    KalmanFilter::BatchOutput output;
+    output.states = states.data();
+
+    for (auto _ : state)
+    {
+        KalmanFilter filter{0.0, ugl::Vector<2>::Zero(), ugl::Vector<2>{0.2, 0.0}};
+        benchmark::DoNotOptimize(filter.process_batch(0.0, imu, sonar, output));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(size));
+}
+BENCHMARK(BM_process_batch)->Arg(100)->Arg(1000);
+
+void BM_prediction_state_jacobian(benchmark::State& state)
+{
+    const double dt = dt_arg(state);
+    const ugl::Vector<5> X = state_vector(heading_arg(state));
+    const ugl::Vector<2> acc{0.1, 0.02};
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(jacobians::prediction_state(dt, X, acc));
+    }
+}
+BENCHMARK(BM_prediction_state_jacobian)->Apply(dt_heading_args);
+
+void BM_prediction_noise_jacobian(benchmark::State& state)
+{
+    const double dt = dt_arg(state);
+    const ugl::Vector<5> X = state_vector(heading_arg(state));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(jacobians::prediction_noise(dt, X));
+    }
+}
+BENCHMARK(BM_prediction_noise_jacobian)->Apply(dt_heading_args);
+
+void BM_command_state_jacobian(benchmark::State& state)
+{
+    const double dt = dt_arg(state);
+    const ugl::Vector<5> X = state_vector(heading_arg(state));
+    const ugl::Vector<2> cmd_vel{0.2, 0.0};
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(jacobians::command_state(dt, X, cmd_vel));
+    }
+}
+BENCHMARK(BM_command_state_jacobian)->Apply(dt_heading_args);
+
+void BM_command_noise_jacobian(benchmark::State& state)
+{
+    const double dt = dt_arg(state);
+    const ugl::Vector<5> X = state_vector(heading_arg(state));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(jacobians::command_noise(dt, X));
+    }
+}
+BENCHMARK(BM_command_noise_jacobian)->Apply(dt_heading_args);
+
+} // namespace
+
+} // namespace pet
+
+BENCHMARK_MAIN();
@@ -0,0 +1,21 @@
+#!/bin/bash
+# Runs kalman_filter_bench and writes its results as JSON, named after the commit and
+# architecture so that runs on different commits and machines (x86/ARM) can be compared,
+# e.g. with compare.py from the Google Benchmark tools:
+#
+#   compare.py benchmarks kalman_filter_bench_<a>_x86_64.json kalman_filter_bench_<b>_armv7l.json
+#
+# Usage: run_kalman_filter_bench.sh <path to kalman_filter_bench> [output directory] [benchmark options...]
+
+set -e
+
+bench=${1:?"usage: $0 <path to kalman_filter_bench> [output directory] [benchmark options...]"}
+out_dir=${2:-.}
+shift $(( $# < 2 ? $# : 2 ))
+
+commit=$(git -C "$(dirname "$0")" rev-parse --short HEAD 2>/dev/null || echo unknown)
+out="${out_dir}/kalman_filter_bench_${commit}_$(uname -m).json"
+
+"${bench}" --benchmark_out="${out}" --benchmark_out_format=json --benchmark_repetitions=5 \
+           --benchmark_report_aggregates_only=true "$@"
+echo "Results written to ${out}"
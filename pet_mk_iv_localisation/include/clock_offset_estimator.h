@@ -0,0 +1,67 @@
+#ifndef PET_LOCALISATION_CLOCK_OFFSET_ESTIMATOR_H
+#define PET_LOCALISATION_CLOCK_OFFSET_ESTIMATOR_H
+
+#include <array>
+
+#include <ros/time.h>
+
+namespace pet
+{
+
+// Estimates offset and skew of a remote clock, e.g. an MCU synchronised through rosserial, against
+// the local clock. Fits a line through the latest (remote stamp, local arrival) pairs and places it
+// on the fastest observed arrival, so that the transport delay is not mistaken for clock offset.
+class ClockOffsetEstimator
+{
+public:
+    // Adds a sample and returns the remote stamp converted to local time. Stamps are
+    // passed through unchanged until enough samples have been collected.
+    ros::Time correct(const ros::Time& remote_stamp, const ros::Time& local_arrival);
+
+    // Rate of the local clock relative to the remote clock.
+    double skew() const
+    {
+        return m_skew;
+    }
+
+    // Local time minus remote time at the latest sample [s].
+    double offset() const
+    {
+        return m_offset;
+    }
+
+private:
+    void reset(const ros::Time& remote_stamp, const ros::Time& local_arrival);
+    void add_sample(double x, double y);
+    void fit();
+
+private:
+    static constexpr int kWindowSize = 64;
+    static constexpr int kMinSamples = 8;
+
+    // Jumps larger than this are treated as a clock reset, e.g. a restarted MCU.
+    static constexpr double kResetThreshold = 0.5;
+
+    // Samples relative to the first one, to keep the sums numerically well-conditioned.
+    ros::Time m_remote_reference;
+    ros::Time m_local_reference;
+
+    std::array<double, kWindowSize> m_x{};
+    std::array<double, kWindowSize> m_y{};
+    int m_next = 0;
+    int m_count = 0;
+
+    double m_sum_x  = 0.0;
+    double m_sum_y  = 0.0;
+    double m_sum_xx = 0.0;
+    double m_sum_xy = 0.0;
+
+    // Fitted line y = m_intercept + m_skew * x.
+    double m_intercept = 0.0;
+    double m_skew = 1.0;
+    double m_offset = 0.0;
+};
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_CLOCK_OFFSET_ESTIMATOR_H
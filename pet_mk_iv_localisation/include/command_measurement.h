@@ -0,0 +1,43 @@
+#ifndef PET_LOCALISATION_COMMAND_MEASUREMENT_H
+#define PET_LOCALISATION_COMMAND_MEASUREMENT_H
+
+#include <geometry_msgs/TwistStamped.h>
+#include <pet_mk_iv_msgs/EngineCommand.h>
+
+#include "measurement.h"
+
+namespace pet
+{
+
+// Commanded motion of the differential drive, used as a prediction source when imu data is sparse.
+class CommandMeasurement: public Measurement
+{
+public:
+    CommandMeasurement(const pet_mk_iv_msgs::EngineCommand& engine_msg);
+    CommandMeasurement(const geometry_msgs::TwistStamped& twist_msg);
+
+    // Commanded forward velocity in the body frame [m/s].
+    double linear_velocity() const
+    {
+        return m_linear_vel;
+    }
+
+    // Commanded angular rate around the body z-axis [rad/s].
+    double angular_velocity() const
+    {
+        return m_angular_vel;
+    }
+
+private:
+    double m_linear_vel;
+    double m_angular_vel;
+
+    // Same values as in the controller of pet_mk_iv_path_planner.
+    static constexpr double kWheelBase = 0.088;
+    static constexpr double kPwmOffset = 40;
+    static constexpr double kPwmVelocityRatio = 255 / 0.52;
+};
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_COMMAND_MEASUREMENT_H
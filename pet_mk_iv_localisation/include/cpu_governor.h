@@ -0,0 +1,98 @@
+#ifndef PET_LOCALISATION_CPU_GOVERNOR_H
+#define PET_LOCALISATION_CPU_GOVERNOR_H
+
+#include <array>
+#include <chrono>
+#include <optional>
+
+namespace pet
+{
+
+// Keeps the CPU share of a node within a budget by choosing a degradation level. The share is
+// measured as the thread CPU time of the node's steps and callbacks over wall time in windows of
+// fixed length, so other nodes of the same process do not count; the level goes up one step after
+// every window over budget and down one step after every window well under it.
+class CpuGovernor
+{
+public:
+    // What is given up at a degradation level. Every divisor:th sample or step is kept.
+    struct Level
+    {
+        int imu_decimation;
+        int publish_divisor;
+        int update_divisor;
+    };
+
+    static constexpr std::array<Level, 5> kLevels{{
+        {1, 1, 1},
+        {2, 1, 1},
+        {2, 2, 1},
+        {4, 2, 2},
+        {4, 4, 4},
+    }};
+
+public:
+    // budget is the share of one CPU [0, 1+), window the measurement period [s].
+    CpuGovernor(double budget, double window);
+
+    // Accounts CPU time [s] the node spent outside its steps, e.g. in subscriber callbacks.
+    void account(double cpu_time) { m_window_cpu_time += cpu_time; }
+
+    // Accounts one filter step which used step_cpu_time [s] of its thread. Returns true
+    // when the degradation level changed.
+    bool update(double step_cpu_time);
+
+    int level() const { return m_level; }
+    const Level& settings() const { return kLevels[m_level]; }
+
+    // CPU share of the node over the latest window.
+    double share() const { return m_share; }
+
+    // CPU time used by the calling thread [s].
+    static double thread_cpu_time();
+
+    // Accounts the CPU time of the calling thread from construction to destruction, if there is
+    // a governor.
+    class Scope
+    {
+    public:
+        explicit Scope(std::optional<CpuGovernor>& governor)
+            : m_governor(governor)
+            , m_start(governor ? thread_cpu_time() : 0.0)
+        {
+        }
+
+        ~Scope()
+        {
+            if (m_governor) {
+                m_governor->account(thread_cpu_time() - m_start);
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        std::optional<CpuGovernor>& m_governor;
+        const double m_start;
+    };
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Load has to fall below this share of the budget before degradation is reduced.
+    static constexpr double kRecoverFraction = 0.7;
+
+    const double m_budget;
+    const Clock::duration m_window;
+
+    Clock::time_point m_window_start;
+    double m_window_cpu_time = 0.0;
+
+    int m_level = 0;
+    double m_share = 0.0;
+};
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_CPU_GOVERNOR_H
@@ -0,0 +1,95 @@
+#ifndef PET_LOCALISATION_FLIGHT_RECORDER_H
+#define PET_LOCALISATION_FLIGHT_RECORDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ros/time.h>
+
+namespace pet
+{
+
+// Fixed-size ring buffer of the latest raw measurements and filter states. Recording is a plain
+// store into preallocated memory; the buffer is only written to disk when dump() is called.
+class FlightRecorder
+{
+public:
+    struct Record
+    {
+        enum class Kind : std::uint8_t
+        {
+            Imu,        // values: acc xyz, rate xyz
+            Sonar,      // values: distance
+            Command,    // values: linear vel, angular vel
+            State,      // values: theta, vel xy, pos xy, innovation nis, processing time, queue latency
+        };
+
+        Kind kind;
+        std::uint8_t sensor;
+        std::uint16_t queue_depth;
+        ros::Time stamp;
+        double values[8];
+    };
+
+public:
+    // Holds the latest duration [s] of records arriving at record_rate [Hz]. Dumps go to directory,
+    // in files named after name, typically the namespace of the robot, so that recorders sharing a
+    // directory do not overwrite each other. Starts the writer thread, which keeps the scheduling
+    // and CPU affinity of the calling thread, so construct the recorder before raising the
+    // priority of the thread that records.
+    FlightRecorder(double duration, double record_rate, const std::string& directory, const std::string& name);
+    ~FlightRecorder();
+
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    void record(const Record& record)
+    {
+        m_buffer[m_next] = record;
+        m_next = (m_next + 1) % m_buffer.size();
+        m_full = m_full || m_next == 0;
+    }
+
+    // Hands a copy of the buffer to the writer thread, which writes it to a new file. Returns
+    // false if a dump is already in progress.
+    bool dump(const std::string& reason);
+
+    // Blocks until the dump in progress, if any, is written.
+    void wait();
+
+private:
+    void run();
+    void write();
+
+private:
+    std::vector<Record> m_buffer;
+    std::size_t m_next = 0;
+    bool m_full = false;
+
+    const std::string m_directory;
+    // Name sanitised for use in a file name, possibly empty.
+    const std::string m_name;
+
+    // Copy of the buffer being written, so that recording can continue meanwhile. Only touched
+    // by dump() while m_writing is clear, and by the writer thread while it is set.
+    std::vector<Record> m_snapshot;
+    std::size_t m_snapshot_count = 0;
+    std::string m_snapshot_path;
+    std::atomic<bool> m_writing{false};
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_written;
+    bool m_pending = false;
+    bool m_stop = false;
+    std::thread m_writer;
+};
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_FLIGHT_RECORDER_H
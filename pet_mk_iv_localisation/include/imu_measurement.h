@@ -6,6 +6,8 @@
 #include <ugl/math/vector.h>
 
 #include "measurement.h"
+#include "imu_sample.h"
+#include "sensor_extrinsics.h"
 
 namespace pet
 {
@@ -15,12 +17,22 @@ class ImuMeasurement: public Measurement
 public:
     ImuMeasurement(const sensor_msgs::Imu& imu_msg);
 
-    // Acceleration as measured by accelerometer.
+    // Converts the measurement from the imu frame to the base frame.
+    ImuMeasurement(const sensor_msgs::Imu& imu_msg, const SensorExtrinsics& extrinsics);
+    ImuMeasurement(const ImuSample& sample, const SensorExtrinsics& extrinsics);
+
+    // Acceleration and angular rate already in the base frame.
+    ImuMeasurement(const ros::Time& stamp, const ugl::Vector3& acc, const ugl::Vector3& rate);
+
+    // Acceleration as measured by accelerometer, in the base frame.
     const ugl::Vector3& acceleration() const;
 
-    // Angular rate as measured by gyroscope.
+    // Angular rate as measured by gyroscope, in the base frame.
     const ugl::Vector3& angular_rate() const;
 
+private:
+    ImuMeasurement(const ros::Time& stamp, const ugl::Vector3& acc, const ugl::Vector3& rate, const SensorExtrinsics& extrinsics);
+
 private:
     ugl::Vector3 m_acc;
     ugl::Vector3 m_rate;
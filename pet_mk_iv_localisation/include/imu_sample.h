@@ -0,0 +1,100 @@
+#ifndef PET_LOCALISATION_IMU_SAMPLE_H
+#define PET_LOCALISATION_IMU_SAMPLE_H
+
+#include <cstdint>
+
+#include <ros/message_traits.h>
+#include <ros/serialization.h>
+#include <ros/time.h>
+
+#include <sensor_msgs/Imu.h>
+
+#include <ugl/math/vector.h>
+
+namespace pet
+{
+
+// The fields of a sensor_msgs/Imu which the filter uses. Subscribing with this type instead of
+// sensor_msgs::Imu decodes them straight from the serialised message and skips the rest:
+// frame id, orientation and covariances. Only decoding is supported, it can not be published.
+struct ImuSample
+{
+    ros::Time stamp;
+    ugl::Vector3 angular_velocity = ugl::Vector3::Zero();
+    ugl::Vector3 linear_acceleration = ugl::Vector3::Zero();
+};
+
+} // namespace pet
+
+namespace ros
+{
+namespace message_traits
+{
+
+// Same type on the wire as sensor_msgs/Imu, so it connects to any Imu publisher.
+template<>
+struct MD5Sum<pet::ImuSample>
+{
+    static const char* value() { return MD5Sum<sensor_msgs::Imu>::value(); }
+    static const char* value(const pet::ImuSample&) { return value(); }
+};
+
+template<>
+struct DataType<pet::ImuSample>
+{
+    static const char* value() { return DataType<sensor_msgs::Imu>::value(); }
+    static const char* value(const pet::ImuSample&) { return value(); }
+};
+
+template<>
+struct Definition<pet::ImuSample>
+{
+    static const char* value() { return Definition<sensor_msgs::Imu>::value(); }
+    static const char* value(const pet::ImuSample&) { return value(); }
+};
+
+} // namespace message_traits
+
+namespace serialization
+{
+
+template<>
+struct Serializer<pet::ImuSample>
+{
+    // Serialised sizes of the skipped fields [bytes].
+    static constexpr std::uint32_t kSeqSize = 4;
+    static constexpr std::uint32_t kOrientationSize = 4 * 8;
+    static constexpr std::uint32_t kCovarianceSize = 9 * 8;
+
+    template<typename Stream>
+    static void read(Stream& stream, pet::ImuSample& sample)
+    {
+        // header
+        stream.advance(kSeqSize);
+        stream.next(sample.stamp.sec);
+        stream.next(sample.stamp.nsec);
+        std::uint32_t frame_id_length = 0;
+        stream.next(frame_id_length);
+        stream.advance(frame_id_length);
+
+        stream.advance(kOrientationSize + kCovarianceSize);
+        read_vector(stream, sample.angular_velocity);
+        stream.advance(kCovarianceSize);
+        read_vector(stream, sample.linear_acceleration);
+        stream.advance(kCovarianceSize);
+    }
+
+private:
+    template<typename Stream>
+    static void read_vector(Stream& stream, ugl::Vector3& vector)
+    {
+        stream.next(vector.x());
+        stream.next(vector.y());
+        stream.next(vector.z());
+    }
+};
+
+} // namespace serialization
+} // namespace ros
+
+#endif // PET_LOCALISATION_IMU_SAMPLE_H
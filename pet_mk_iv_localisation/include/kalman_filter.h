@@ -1,9 +1,15 @@
 #ifndef PET_LOCALISATION_KALMAN_FILTER_H
 #define PET_LOCALISATION_KALMAN_FILTER_H
 
+#include <cstddef>
+
+#include <Eigen/Cholesky>
+
 #include <ugl/math/vector.h>
 #include <ugl/math/matrix.h>
 
+#include "tracepoints.h"
+
 namespace pet
 {
 
@@ -16,6 +22,69 @@ public:
     template<int rows, int cols>
     using Jacobian = ugl::Matrix<rows, cols>;
 
+    // Linear observation z = H*X + w of dimension m, where w has covariance R.
+    template<int m>
+    struct Observation
+    {
+        static constexpr int kSize = m;
+
+        ugl::Vector<m> z;
+        Jacobian<m,5> H;
+        Covariance<m> R;
+    };
+
+    // Imu samples as a structure of arrays, each of length size. Stamps [s], acceleration [m/s^2]
+    // and angular rate [rad/s] in the base frame.
+    struct ImuBatch
+    {
+        std::size_t size = 0;
+        const double* stamp = nullptr;
+        const double* acc_x = nullptr;
+        const double* acc_y = nullptr;
+        const double* acc_z = nullptr;
+        const double* rate_x = nullptr;
+        const double* rate_y = nullptr;
+        const double* rate_z = nullptr;
+    };
+
+    // Sonar velocity observations interleaved with an ImuBatch, each of length size. Observation i
+    // is applied once the first index[i] imu samples have been predicted, so indices are
+    // non-decreasing and at most the imu batch size. Directions default to the body x-axis, and
+    // variances [(m/s)^2] to those of sonar_velocity_observation without them.
+    struct SonarBatch
+    {
+        std::size_t size = 0;
+        const std::size_t* index = nullptr;
+        const double* velocity = nullptr;
+        const double* direction = nullptr;
+        const double* variance = nullptr;
+    };
+
+    // Per imu sample outputs of a batch, skipped where null. States are written as rows of
+    // [theta, vel x, vel y, pos x, pos y]. The NIS is that of the latest update applied with the
+    // sample, and NaN for samples without one.
+    struct BatchOutput
+    {
+        double* states = nullptr;
+        double* innovation_nis = nullptr;
+    };
+
+    // Variances of the process noise [theta, vel x, vel y] of the two prediction models.
+    struct ProcessNoise
+    {
+        // TODO: Estimate real noise values.
+        double imu = 0.1;
+        // Commands know nothing about wheel slip or motor response.
+        double command = 0.1;
+    };
+
+    // Indices into the state vector.
+    static constexpr int kIndexTheta = 0;
+    static constexpr int kIndexVelX = 1;
+    static constexpr int kIndexVelY = 2;
+    static constexpr int kIndexPosX = 3;
+    static constexpr int kIndexPosY = 4;
+
 public:
     KalmanFilter() = default;
     KalmanFilter(double theta, const ugl::Vector<2>& position, const ugl::Vector<2>& velocity);
@@ -23,26 +92,74 @@ public:
     double heading() const { return m_X[kIndexTheta]; }
     ugl::Vector<2> velocity() const { return m_X.segment<2>(kIndexVelX); }
     ugl::Vector<2> position() const { return m_X.segment<2>(kIndexPosX); }
+    const Covariance<5>& covariance() const { return m_P; }
+
+    // Normalised innovation squared of the latest update, large values indicate inconsistent observations.
+    double innovation_nis() const { return m_innovation_nis; }
+
+    // Innovation of the latest update. Only the first innovation_size() elements are valid.
+    const ugl::Vector<4>& innovation() const { return m_innovation; }
+    int innovation_size() const { return m_innovation_size; }
 
     void set_heading(double theta) { m_X[kIndexTheta] = theta; }
     void set_velocity(const ugl::Vector<2>& velocity) { m_X.segment<2>(kIndexVelX) = velocity; }
     void set_position(const ugl::Vector<2>& position) { m_X.segment<2>(kIndexPosX) = position; }
+    void set_covariance(const Covariance<5>& P) { m_P = P; }
+
+    const ProcessNoise& process_noise() const { return m_process_noise; }
+    void set_process_noise(const ProcessNoise& noise) { m_process_noise = noise; }
 
     // Predicts new state from time passed and accelerometer+gyroscope measurements.
     void predict(double dt, const ugl::Vector3& acc, const ugl::Vector3& ang_vel);
 
+    // Predicts new state from time passed and commanded forward velocity and angular rate of a differential drive.
+    void command_predict(double dt, double linear_vel, double angular_vel);
+
     // Updates state estimation from a sonar measurement of forward velocity in the body frame.
     void sonar_velocity_update(double velocity);
 
+    // Updates state estimation from n simultaneous sonar measurements of velocity in the body frame,
+    // each one measured along the axis of its sonar. Directions are given as angles from the body x-axis.
+    template<int n>
+    void sonar_velocity_update(const ugl::Vector<n>& velocities, const ugl::Vector<n>& directions);
+
     // Updates state estimation from a pseduo-measurement of zero lateral velocity in the body frame.
     void pseudo_lateral_velocity_update(double velocity);
 
-private:
-    // Returns the jacobian of the prediction function with regards to the state, df/dX.
-    static Jacobian<5,5> prediction_state_jacobian(double dt, const ugl::Vector<5> X, const ugl::Vector<2>& acc);
+    // Updates state estimation from a pseudo-measurement of zero velocity, for when the robot is known to stand still.
+    void zero_velocity_update();
+
+    // Predicts through all imu samples of a batch in one loop, applying the interleaved sonar
+    // observations together with the lateral pseudo-observation, the way kalman_node does. The
+    // first sample is predicted from start [s]. Returns the stamp predicted up to.
+    double process_batch(double start, const ImuBatch& imu, const SonarBatch& sonar, const BatchOutput& output);
+
+    // Updates state estimation from all given observations at once. The observations are stacked
+    // into one, so the covariance is only updated once and only one small system is solved.
+    template<typename... Observations>
+    void update(const Observations&... observations);
+
+    // Returns observation of forward velocity in the body frame from a sonar.
+    static Observation<1> sonar_velocity_observation(double velocity);
+
+    // Returns observation of velocities in the body frame from n sonars, see sonar_velocity_update.
+    template<int n>
+    static Observation<n> sonar_velocity_observation(const ugl::Vector<n>& velocities, const ugl::Vector<n>& directions);
+
+    // Same as above, with the variance of each velocity given [(m/s)^2].
+    template<int n>
+    static Observation<n> sonar_velocity_observation(const ugl::Vector<n>& velocities, const ugl::Vector<n>& directions,
+                                                     const ugl::Vector<n>& variances);
+
+    // Returns pseudo-observation of lateral velocity in the body frame.
+    static Observation<1> pseudo_lateral_velocity_observation(double velocity);
 
-    // Returns the jacobian of the prediction function with regards to the noise, df/dV.
-    static Jacobian<5,3> prediction_noise_jacobian(double dt, const ugl::Vector<5> X);
+    // Returns pseudo-observation of zero velocity in the body frame.
+    static Observation<2> zero_velocity_observation();
+
+private:
+    template<int m>
+    void fused_update(const Observation<m>& observation);
 
 private:
     // State vector [theta, vel, pos].
@@ -51,13 +168,61 @@ private:
     // Error covariance [theta, vel, pos].
     Covariance<5> m_P = Covariance<5>::Identity() * 0.1;
 
-    static constexpr int kIndexTheta = 0;
-    static constexpr int kIndexVelX = 1;
-    static constexpr int kIndexVelY = 2;
-    static constexpr int kIndexPosX = 3;
-    static constexpr int kIndexPosY = 4;
+    ProcessNoise m_process_noise;
+
+    double m_innovation_nis = 0.0;
+
+    // Leading part of the latest innovation, kept for logging.
+    ugl::Vector<4> m_innovation = ugl::Vector<4>::Zero();
+    int m_innovation_size = 0;
+
 };
 
+template<typename... Observations>
+void KalmanFilter::update(const Observations&... observations)
+{
+    constexpr int m = (0 + ... + Observations::kSize);
+    if constexpr (m > 0)
+    {
+        PET_TRACE(update_begin, m);
+
+        Observation<m> stacked;
+        stacked.R.setZero();
+
+        int row = 0;
+        ((stacked.z.template segment<Observations::kSize>(row) = observations.z,
+          stacked.H.template middleRows<Observations::kSize>(row) = observations.H,
+          stacked.R.template block<Observations::kSize, Observations::kSize>(row, row) = observations.R,
+          row += Observations::kSize), ...);
+
+        fused_update(stacked);
+
+        PET_TRACE(update_end, m);
+    }
+}
+
+template<int m>
+void KalmanFilter::fused_update(const Observation<m>& observation)
+{
+    const ugl::Matrix<5,m> PHt = m_P * observation.H.transpose();
+    const Covariance<m> S = observation.H * PHt + observation.R;
+
+    // K = P*H'*inv(S), solved through the symmetric positive definite S instead of inverting it.
+    const auto S_ldlt = S.ldlt();
+    const ugl::Matrix<5,m> K = S_ldlt.solve(PHt.transpose()).transpose();
+
+    const ugl::Vector<m> innovation = observation.z - observation.H * m_X;
+    m_innovation_nis = innovation.dot(S_ldlt.solve(innovation));
+
+    constexpr int kept = (m < 4) ? m : 4;
+    m_innovation.head<kept>() = innovation.template head<kept>();
+    m_innovation_size = kept;
+
+    m_X = m_X + K*innovation;
+
+    m_P = m_P - K*PHt.transpose();
+}
+
 } // namespace pet
 
 #endif // PET_LOCALISATION_KALMAN_FILTER_H
\ No newline at end of file
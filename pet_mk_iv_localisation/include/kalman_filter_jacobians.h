@@ -0,0 +1,27 @@
+#ifndef PET_LOCALISATION_KALMAN_FILTER_JACOBIANS_H
+#define PET_LOCALISATION_KALMAN_FILTER_JACOBIANS_H
+
+#include <ugl/math/vector.h>
+#include <ugl/math/matrix.h>
+
+// Jacobians of the prediction models of KalmanFilter, internal to it and its benchmarks.
+// States are [theta, vel x, vel y, pos x, pos y], noise is [theta, vel x, vel y].
+
+namespace pet::jacobians
+{
+
+// Returns the jacobian of the prediction function with regards to the state, df/dX.
+ugl::Matrix<5,5> prediction_state(double dt, const ugl::Vector<5>& X, const ugl::Vector<2>& acc);
+
+// Returns the jacobian of the prediction function with regards to the noise, df/dV.
+ugl::Matrix<5,3> prediction_noise(double dt, const ugl::Vector<5>& X);
+
+// Returns the jacobian of the command prediction function with regards to the state, df/dX.
+ugl::Matrix<5,5> command_state(double dt, const ugl::Vector<5>& X, const ugl::Vector<2>& cmd_vel);
+
+// Returns the jacobian of the command prediction function with regards to the noise, df/dV.
+ugl::Matrix<5,3> command_noise(double dt, const ugl::Vector<5>& X);
+
+} // namespace pet::jacobians
+
+#endif // PET_LOCALISATION_KALMAN_FILTER_JACOBIANS_H
@@ -0,0 +1,57 @@
+#ifndef PET_LOCALISATION_KALMAN_FLEET_H
+#define PET_LOCALISATION_KALMAN_FLEET_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+
+#include "kalman_node.h"
+#include "pooled_callback_queue.h"
+#include "thread_pool.h"
+
+namespace pet
+{
+
+// Hosts the localisation of several robots in one process. Each robot gets its own namespaced
+// KalmanNode, and the callbacks of all of them are run on one shared thread pool.
+class KalmanFleet
+{
+private:
+    struct Robot
+    {
+        Robot(const std::string& name, ThreadPool& pool);
+
+        const std::string name;
+        PooledCallbackQueue queue;
+        ros::NodeHandle nh;
+        ros::NodeHandle nh_private;
+        std::unique_ptr<KalmanNode> node;
+
+        // Growth of the process' resident memory while the robot was initialised [kB].
+        long memory_kb = 0;
+        int64_t previous_cpu_time_ns = 0;
+    };
+
+public:
+    KalmanFleet(ros::NodeHandle& nh_private);
+    ~KalmanFleet();
+
+    void start();
+
+private:
+    void report_cb(const ros::WallTimerEvent& e);
+
+private:
+    ros::NodeHandle& m_nh_private;
+
+    ThreadPool m_pool;
+    std::vector<std::unique_ptr<Robot>> m_robots;
+
+    ros::WallTimer m_report_timer;
+};
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_KALMAN_FLEET_H
@@ -1,89 +1,328 @@
 #ifndef PET_LOCALISATION_KALMAN_NODE_H
 #define PET_LOCALISATION_KALMAN_NODE_H
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 #include <queue>
+#include <variant>
 
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 
-#include <tf2_ros/transform_broadcaster.h>
+#include <tf2_ros/buffer.h>
 
 #include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/TwistStamped.h>
 #include <geometry_msgs/Vector3Stamped.h>
 #include <pet_mk_iv_msgs/DistanceMeasurement.h>
+#include <pet_mk_iv_msgs/EngineCommand.h>
+#include <pet_mk_iv_msgs/FilterDivergence.h>
 #include <sensor_msgs/Imu.h>
+#include <sensor_msgs/Range.h>
+#include <std_msgs/UInt8.h>
+#include <std_srvs/Trigger.h>
+#include <tf2_msgs/TFMessage.h>
+
+#include <ugl/math/vector.h>
 
 #include "kalman_filter.h"
 #include "measurement.h"
 #include "imu_measurement.h"
+#include "imu_sample.h"
 #include "sonar_measurement.h"
+#include "command_measurement.h"
+#include "clock_offset_estimator.h"
+#include "range_rate_estimator.h"
+#include "state_checkpoint.h"
+#include "startup_utility.h"
+#include "sensor_extrinsics.h"
+#include "flight_recorder.h"
+#include "state_log_writer.h"
+#include "pose_channel_writer.h"
+#include "stationary_detector.h"
+#include "cpu_governor.h"
+#include "shadow_filter.h"
 
 namespace pet
 {
 
 class KalmanNode
 {
+protected:
+    // Measurements shed since processing last fell behind.
+    struct LoadShedding
+    {
+        std::uint64_t imu_dropped = 0;
+        std::uint64_t sonar_dropped = 0;
+        std::uint64_t command_dropped = 0;
+        std::uint64_t imu_decimated = 0;
+        std::uint64_t imu_coalesced = 0;
+    };
+
 private:
-    using MeasurementPtr = std::shared_ptr<const Measurement>;
+    // Measurements are queued by value in preallocated storage, so receiving one does not allocate.
+    using QueuedMeasurement = std::variant<ImuMeasurement, SonarMeasurement, CommandMeasurement>;
+
+    static const ros::Time& stamp_of(const QueuedMeasurement& measurement)
+    {
+        return std::visit([](const Measurement& m) -> const ros::Time& { return m.stamp(); }, measurement);
+    }
 
     // Lower/earlier time stamp has higher priority.
     struct MeasurementPriority
     {
-        bool operator()(const MeasurementPtr& lhs, const MeasurementPtr& rhs) const {
-            return lhs->stamp() > rhs->stamp();
+        bool operator()(const QueuedMeasurement& lhs, const QueuedMeasurement& rhs) const {
+            return stamp_of(lhs) > stamp_of(rhs);
         }
     };
 
+    // Priority queue which can also give up its oldest measurement of one kind, to shed load.
+    class MeasurementQueue : public std::priority_queue<QueuedMeasurement, std::vector<QueuedMeasurement>, MeasurementPriority>
+    {
+    public:
+        void reserve(std::size_t capacity) { c.reserve(capacity); }
+
+        template<typename T>
+        bool remove_oldest()
+        {
+            auto oldest = c.end();
+            for (auto it = c.begin(); it != c.end(); ++it)
+            {
+                if (std::holds_alternative<T>(*it) && (oldest == c.end() || stamp_of(*it) < stamp_of(*oldest))) {
+                    oldest = it;
+                }
+            }
+            if (oldest == c.end()) {
+                return false;
+            }
+            c.erase(oldest);
+            std::make_heap(c.begin(), c.end(), comp);
+            return true;
+        }
+    };
+
+    // What is done with imu samples while processing falls behind.
+    enum class ImuOverloadPolicy
+    {
+        None,
+        Decimate,   // Only every queue/imu_decimation:th sample is used.
+        Coalesce,   // Consecutive samples are integrated as one step.
+    };
+
+    // Static configuration and running state of one range sensor (sonar).
+    struct RangeSensor
+    {
+        std::string frame_id;
+
+        // Mounting position in the body frame [m].
+        ugl::Vector<2> position = ugl::Vector<2>::Zero();
+        // Mounting direction as angle from the body x-axis [rad].
+        double direction = 0.0;
+        // Position and direction are resolved from TF instead of given as parameters.
+        bool from_tf = false;
+
+        // Index of the sensor's topic in the readiness barrier.
+        int topic_index = -1;
+
+        ros::Time previous_stamp;
+        RangeRateEstimator range_rate;
+
+        // Latest velocity observation not yet applied to the filter, and its variance.
+        double velocity = 0.0;
+        double variance = 0.0;
+        bool has_velocity = false;
+
+        // Stamps from rosserial devices are made on the MCU and corrected to the local clock.
+        bool clock_sync = true;
+        ClockOffsetEstimator clock;
+    };
+
 public:
     KalmanNode(ros::NodeHandle& nh, ros::NodeHandle& nh_private);
+    ~KalmanNode();
 
+    // Processes on a ros::Timer, driven by the spinner of the node's callback queue.
     void start();
 
+    // Alternative to start() and spinning: serves the callback queue and processes on monotonic
+    // deadlines in the calling thread, at real-time priority. Returns on shutdown.
+    void run_realtime(ros::CallbackQueue& queue);
+
+protected:
+    // Entry points of the processing path, so that a subclass can drive the node directly
+    // instead of through its timer and subscribers, as the tests in test/ do.
+    void begin(const ros::Time& now);
+    void step(const ros::Time& now);
+    void timer_cb(const ros::TimerEvent& e);
+    void imu_cb(const ImuSample& msg);
+    void sonar_cb(const pet_mk_iv_msgs::DistanceMeasurement& msg);
+
+    std::size_t queue_size() const { return m_queue.size(); }
+    const LoadShedding& load_shedding() const { return m_load_shedding; }
+    bool overloaded() const { return m_overloaded; }
+    const tf2_ros::Buffer& tf_buffer() const { return m_tf_buffer; }
+
+    // Subscribers of the tf, pose and velocity outputs, in this process or not.
+    std::uint32_t output_subscribers() const
+    {
+        return m_tf_pub.getNumSubscribers() + m_pose_pub.getNumSubscribers() + m_velocity_pub.getNumSubscribers();
+    }
+
 private:
     void initialise_kalman_filter();
+    void load_overload_policy();
+    void start_shadow();
+    const CpuGovernor::Level& degradation() const;
+    void load_range_sensors();
+    void subscribe_command();
+    int find_range_sensor(const std::string& frame_id) const;
+    ros::Time correct_range_stamp(RangeSensor& sensor, const ros::Time& stamp);
+    bool resolve_extrinsics();
+    bool lookup_extrinsics(const std::string& frame, SensorExtrinsics& extrinsics) const;
     ros::Duration get_queue_latency(const ros::Time& now) const;
+    void enqueue(const QueuedMeasurement& measurement);
+    void update_overload(const ros::Time& now, const ros::Duration& latency);
 
-    void timer_cb(const ros::TimerEvent& e);
     void process_imu_measurement(const ImuMeasurement& measurement);
+    void coalesce_imu_measurements(const ImuMeasurement& first, const ros::Time& horizon);
     void process_sonar_measurement(const SonarMeasurement& measurement);
+    void process_command_measurement(const CommandMeasurement& measurement);
+    void velocity_update();
+    void command_predict(const ros::Time& until);
+    void update_idle();
+    void record_measurement(const SonarMeasurement& measurement);
+    void record_measurement(const CommandMeasurement& measurement);
+    void record_state(const ros::Time& stamp, const ros::Duration& latency, double processing_time);
+    void dump_flight_recorder(const ros::Time& now, const std::string& reason);
 
-    void imu_cb(const sensor_msgs::Imu& msg);
-    void sonar_cb(const pet_mk_iv_msgs::DistanceMeasurement& msg);
+    void range_cb(const sensor_msgs::Range& msg);
+    void engine_command_cb(const pet_mk_iv_msgs::EngineCommand& msg);
+    void cmd_vel_cb(const geometry_msgs::TwistStamped& msg);
+    void tf_static_cb(const tf2_msgs::TFMessage& msg);
+    bool dump_flight_recorder_cb(std_srvs::Trigger::Request& req, std_srvs::Trigger::Response& res);
 
     void publish_tf(const ros::Time& stamp);
     void publish_pose(const ros::Time& stamp);
     void publish_velocity(const ros::Time& stamp);
+    void publish_degradation_level();
+    void shadow_report_cb(const ros::WallTimerEvent& e);
+    void publish_shadow_report(const ShadowFilter::Report& report);
 
 private:
     ros::NodeHandle& m_nh;
     ros::NodeHandle& m_nh_private;
 
     ros::Subscriber m_imu_sub;
-    ros::Subscriber m_sonar_sub;
+    std::vector<ros::Subscriber> m_range_subs;
+    ros::Subscriber m_command_sub;
+    ros::Subscriber m_tf_static_sub;
 
+    ros::Publisher m_tf_pub;
     ros::Publisher m_pose_pub;
     ros::Publisher m_velocity_pub;
+    ros::Publisher m_degradation_pub;
+    ros::Publisher m_shadow_pose_pub;
+    ros::Publisher m_shadow_divergence_pub;
 
-    tf2_ros::TransformBroadcaster m_tf_broadcaster;
+    ros::ServiceServer m_dump_flight_recorder_srv;
 
-    geometry_msgs::TransformStamped m_tf_msg;
+    // Published directly instead of through a tf2_ros::TransformBroadcaster, which builds a new message every call.
+    tf2_msgs::TFMessage m_tf_msg;
     geometry_msgs::PoseStamped m_pose_msg;
     geometry_msgs::Vector3Stamped m_vel_msg;
 
     const std::string m_base_frame;
     const std::string m_map_frame;
+    const std::string m_imu_frame;
+
+    // Processing period [s].
+    const double m_period;
+
+    // Only used to resolve static sensor extrinsics, never per measurement. Fed from /tf_static
+    // alone, so that the node does not deserialise every dynamic transform, including its own.
+    tf2_ros::Buffer m_tf_buffer;
+    bool m_extrinsics_dirty = true;
+
+    SensorExtrinsics m_imu_extrinsics;
 
     ros::Timer m_timer;
 
+    // Processing starts once every sensor has published, or the startup timeout has passed.
+    utility::ReadinessBarrier m_readiness;
+    int m_imu_topic_index;
+    bool m_started = false;
+
     KalmanFilter m_kalman_filter;
 
-    std::priority_queue<MeasurementPtr, std::vector<MeasurementPtr>, MeasurementPriority> m_queue;
+    StateCheckpoint m_checkpoint;
+
+    // Latest raw measurements and filter states, written to disk on request or when an anomaly is detected.
+    // Holds flight_recorder/duration seconds of measurements at flight_recorder/measurement_rate and states.
+    FlightRecorder m_flight_recorder;
+    const double m_flight_recorder_max_nis;
+    const ros::Duration m_flight_recorder_cooldown;
+    ros::Time m_flight_recorder_previous_dump;
+
+    // Every filter step, if enabled through the state_log/path parameter.
+    StateLogWriter m_state_log;
+
+    // Latest state in shared memory for local consumers, if enabled through the pose_channel/name parameter.
+    PoseChannelWriter m_pose_channel;
+
+    MeasurementQueue m_queue;
+
+    // The queue is bounded, and load is shed while processing lags behind until it is back in real time.
+    const std::size_t m_queue_capacity;
+    ImuOverloadPolicy m_overload_imu_policy = ImuOverloadPolicy::Coalesce;
+    int m_overload_imu_decimation = 2;
+    bool m_overload_drop_oldest_sonar = true;
+    bool m_overloaded = false;
+    ros::Time m_overload_start;
+    std::uint64_t m_imu_count = 0;
+    LoadShedding m_load_shedding;
+
+    std::vector<RangeSensor> m_range_sensors;
 
     ros::Time m_previous_imu_time;
-    ros::Time m_previous_sonar_time;
-    double m_previous_sonar_distance;
+    ros::Time m_previous_predict_time;
+    double m_previous_angular_rate = 0.0;
+
+    // Latest commanded motion, used for prediction when imu data is sparse.
+    bool m_has_command = false;
+    double m_command_linear_vel = 0.0;
+    double m_command_angular_vel = 0.0;
+    ros::Duration m_command_imu_timeout;
+
+    // While the robot is parked the filter idles: no covariance propagation, no sonar updates
+    // and a reduced publish rate, entered with a zero velocity update.
+    StationaryDetector m_stationary_detector;
+    bool m_stationary_enabled;
+    const bool m_stationary_require_command;
+    const int m_idle_publish_divisor;
+    bool m_idle = false;
+
+    // Degrades imu rate, publish rate and update rate to stay within a CPU budget, if one is configured.
+    // Steps and subscriber callbacks account the CPU time of their thread to it.
+    std::optional<CpuGovernor> m_governor;
+    std::uint64_t m_publish_cycles = 0;
+    std::uint64_t m_update_cycles = 0;
+
+    // Alternative filter configuration evaluated against this one, if enabled through shadow/enabled.
+    // Its CPU time is left out of the governor's budget.
+    std::optional<ShadowFilter> m_shadow;
+    // Its reports are published from a spinner thread of normal priority, started before
+    // run_realtime() changes the scheduling of the process, on a queue of its own.
+    ros::CallbackQueue m_shadow_queue;
+    ros::WallTimer m_shadow_report_timer;
+    std::optional<ros::AsyncSpinner> m_shadow_spinner;
+
+    // Configurable versions of kQueueMinLatency and kQueueMaxLatency.
+    const ros::Duration m_queue_min_latency;
+    const ros::Duration m_queue_max_latency;
 
 private:
     // Minimum amount of time a measurement will wait in the queue before processing.
@@ -95,6 +334,15 @@ private:
     static const ros::Duration kImuMaxDuration;
     // Maximum duration between two consecutive sonar measurements for which we still use the measurement.
     static const ros::Duration kSonarMaxDuration;
+
+    // Time before a real-time deadline at which serving callbacks stops [s].
+    static const double kCallbackSlack;
+
+    // Maximum number of range sensors which can be fused by the filter.
+    static constexpr int kMaxRangeSensors = 3;
+
+    // Default number of measurements the queue holds before load is shed.
+    static constexpr int kQueueCapacity = 1024;
 };
 
 } // namespace pet
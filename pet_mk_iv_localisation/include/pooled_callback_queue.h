@@ -0,0 +1,52 @@
+#ifndef PET_LOCALISATION_POOLED_CALLBACK_QUEUE_H
+#define PET_LOCALISATION_POOLED_CALLBACK_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <ros/callback_queue.h>
+#include <ros/callback_queue_interface.h>
+
+#include "thread_pool.h"
+
+namespace pet
+{
+
+// Callback queue which runs its callbacks as tasks on a shared thread pool. Callbacks of one
+// queue are still run one at a time and in order, so the owning node needs no locking.
+// Callbacks are held until start(), so that none runs while the owning node is constructed.
+class PooledCallbackQueue: public ros::CallbackQueueInterface
+{
+public:
+    explicit PooledCallbackQueue(ThreadPool& pool);
+
+    void addCallback(const ros::CallbackInterfacePtr& callback, uint64_t owner_id = 0) override;
+    void removeByID(uint64_t owner_id) override;
+
+    // Releases the callbacks held so far and runs every later one as it is added.
+    void start();
+
+    // Thread CPU time spent running callbacks from this queue.
+    std::chrono::nanoseconds cpu_time() const
+    {
+        return std::chrono::nanoseconds{m_cpu_time_ns.load(std::memory_order_relaxed)};
+    }
+
+private:
+    void drain();
+
+private:
+    ThreadPool& m_pool;
+    ros::CallbackQueue m_queue;
+
+    // Callbacks added but not yet drained. A drain task is only submitted on the first one.
+    // Starts at one until start(), which keeps addCallback() from submitting any.
+    std::atomic<int> m_pending{1};
+
+    std::atomic<int64_t> m_cpu_time_ns{0};
+};
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_POOLED_CALLBACK_QUEUE_H
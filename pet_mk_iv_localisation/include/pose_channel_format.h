@@ -0,0 +1,48 @@
+#ifndef PET_LOCALISATION_POSE_CHANNEL_FORMAT_H
+#define PET_LOCALISATION_POSE_CHANNEL_FORMAT_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace pet
+{
+
+// Latest filter state as shared with local readers.
+struct PoseSample
+{
+    // Filter time of the state [ns].
+    std::int64_t stamp;
+    double heading;
+    double velocity_x;
+    double velocity_y;
+    double position_x;
+    double position_y;
+};
+
+static_assert(std::is_standard_layout<PoseSample>::value && sizeof(PoseSample) == 6 * 8, "PoseSample must be six plain words.");
+
+// Layout of the POSIX shared memory segment of the pose channel, guarded by a seqlock: the writer
+// makes the sequence odd, writes the payload and makes it even again, and a reader retries when
+// the sequence was odd or changed while it copied the payload. Neither side ever blocks the other.
+// The payload is stored as relaxed atomic words so that concurrent access is well-defined.
+// Any change must bump kVersion.
+struct PoseChannelLayout
+{
+    static constexpr std::uint32_t kMagic = 0x50455450; // "PETP"
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::size_t kWords = sizeof(PoseSample) / sizeof(std::uint64_t);
+
+    std::uint32_t magic;
+    std::uint32_t version;
+    // Twice the number of completed writes, odd while a write is in progress.
+    std::atomic<std::uint64_t> sequence;
+    std::atomic<std::uint64_t> payload[kWords];
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "The seqlock needs lock-free 64-bit atomics to work across processes.");
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_POSE_CHANNEL_FORMAT_H
@@ -0,0 +1,63 @@
+#ifndef PET_LOCALISATION_POSE_CHANNEL_READER_H
+#define PET_LOCALISATION_POSE_CHANNEL_READER_H
+
+#include <cstdint>
+#include <string>
+
+#include "pose_channel_format.h"
+
+namespace pet
+{
+
+// Reads the latest filter state published by kalman_node into shared memory, see the
+// pose_channel/name parameter. Reading is a copy of a few words and never blocks the node.
+// Does not depend on ROS, and is also exposed through a C interface for other languages.
+class PoseChannelReader
+{
+public:
+    PoseChannelReader() = default;
+    ~PoseChannelReader();
+
+    PoseChannelReader(const PoseChannelReader&) = delete;
+    PoseChannelReader& operator=(const PoseChannelReader&) = delete;
+
+    // Opens an existing channel. On failure returns false and error() tells why.
+    bool open(const std::string& name);
+    void close();
+
+    bool is_open() const
+    {
+        return m_layout != nullptr;
+    }
+
+    const std::string& error() const { return m_error; }
+
+    // Copies the latest sample. Returns false when nothing has been written yet, or when the
+    // writer kept updating through kMaxAttempts tries, so that a call always takes bounded time.
+    bool read(PoseSample& sample) const;
+
+    // Number of samples written since the channel was created, to tell whether there is new data.
+    std::uint64_t count() const;
+
+private:
+    static constexpr int kMaxAttempts = 64;
+
+    const PoseChannelLayout* m_layout = nullptr;
+    std::string m_error;
+};
+
+} // namespace pet
+
+extern "C"
+{
+
+// C interface of PoseChannelReader, e.g. for ctypes. open returns nullptr on failure,
+// read returns 1 on success and 0 otherwise.
+void* pet_pose_channel_open(const char* name);
+int pet_pose_channel_read(const void* channel, pet::PoseSample* sample);
+std::uint64_t pet_pose_channel_count(const void* channel);
+void pet_pose_channel_close(void* channel);
+
+}
+
+#endif // PET_LOCALISATION_POSE_CHANNEL_READER_H
@@ -0,0 +1,41 @@
+#ifndef PET_LOCALISATION_POSE_CHANNEL_WRITER_H
+#define PET_LOCALISATION_POSE_CHANNEL_WRITER_H
+
+#include <cstdint>
+#include <string>
+
+#include "pose_channel_format.h"
+
+namespace pet
+{
+
+// Publishes the latest filter state into a POSIX shared memory segment, for local consumers
+// which should not go through ROS transport. See PoseChannelReader for the other side.
+class PoseChannelWriter
+{
+public:
+    PoseChannelWriter() = default;
+    ~PoseChannelWriter();
+
+    PoseChannelWriter(const PoseChannelWriter&) = delete;
+    PoseChannelWriter& operator=(const PoseChannelWriter&) = delete;
+
+    // Creates or reuses the segment with the given name, e.g. "/pet_pose". Returns false on failure.
+    bool open(const std::string& name);
+    void close();
+
+    bool is_open() const
+    {
+        return m_layout != nullptr;
+    }
+
+    void write(const PoseSample& sample);
+
+private:
+    PoseChannelLayout* m_layout = nullptr;
+    std::uint64_t m_sequence = 0;
+};
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_POSE_CHANNEL_WRITER_H
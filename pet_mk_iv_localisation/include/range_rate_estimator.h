@@ -0,0 +1,66 @@
+#ifndef PET_LOCALISATION_RANGE_RATE_ESTIMATOR_H
+#define PET_LOCALISATION_RANGE_RATE_ESTIMATOR_H
+
+#include <array>
+
+#include <ros/time.h>
+
+namespace pet
+{
+
+// Estimates the rate of change of a range sensor's distance by least squares over its latest
+// samples, instead of differencing only the last two. Running sums make adding a sample O(1).
+// The slope is that of the whole window, so it lags the newest sample by half the window.
+class RangeRateEstimator
+{
+public:
+    static constexpr int kMaxWindowSize = 16;
+
+public:
+    // The window is clamped to [3, kMaxWindowSize] samples.
+    explicit RangeRateEstimator(int window_size = 5);
+
+    void add(const ros::Time& stamp, double range);
+    void reset();
+
+    // A rate is estimated once the window holds three samples spread in time.
+    bool has_estimate() const { return m_has_estimate; }
+
+    // Rate of change of the range [m/s], and the variance of the estimate [(m/s)^2].
+    double rate() const { return m_rate; }
+    double variance() const { return m_variance; }
+
+private:
+    void recompute_sums();
+    void fit();
+
+private:
+    static constexpr int kMinSamples = 3;
+
+    // A perfect line through the samples does not make the sensor exact.
+    static constexpr double kMinVariance = 1e-4;
+
+    int m_window_size;
+
+    // Sample times relative to a reference which follows the window, to keep the sums well-conditioned.
+    ros::Time m_reference;
+
+    std::array<double, kMaxWindowSize> m_t{};
+    std::array<double, kMaxWindowSize> m_range{};
+    int m_next = 0;
+    int m_count = 0;
+
+    double m_sum_t  = 0.0;
+    double m_sum_r  = 0.0;
+    double m_sum_tt = 0.0;
+    double m_sum_tr = 0.0;
+    double m_sum_rr = 0.0;
+
+    bool m_has_estimate = false;
+    double m_rate = 0.0;
+    double m_variance = 0.0;
+};
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_RANGE_RATE_ESTIMATOR_H
@@ -0,0 +1,71 @@
+#ifndef PET_LOCALISATION_REALTIME_H
+#define PET_LOCALISATION_REALTIME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pet::realtime
+{
+
+// Gives the calling thread SCHED_FIFO scheduling at the given priority (1-99). Needs
+// CAP_SYS_NICE or an rtprio limit, returns false otherwise.
+bool set_fifo_priority(int priority);
+
+// Gives the calling thread SCHED_IDLE scheduling, so it only runs on CPU time nothing else wants.
+bool set_idle_priority();
+
+// Pins the calling thread to the given CPUs.
+bool set_cpu_affinity(const std::vector<int>& cpus);
+
+// Locks all current and future memory of the process, which also faults in everything already
+// allocated, stops the heap from returning memory to the system and prefaults stack_size bytes
+// of the calling thread's stack. Nothing allocated up front will page fault afterwards.
+bool lock_memory(std::size_t stack_size = 256 * 1024);
+
+// Periodic deadlines on the monotonic clock. Late or overrunning cycles never shift the phase:
+// the next deadline is always the first one of the original schedule that has not yet passed,
+// and every skipped deadline is counted as missed.
+class DeadlineScheduler
+{
+public:
+    struct Statistics
+    {
+        std::uint64_t cycles = 0;
+        std::uint64_t missed = 0;
+        // Worst delay of a wake-up after its deadline, and worst time from a deadline to the end of its cycle [s].
+        double max_lateness = 0.0;
+        double max_duration = 0.0;
+    };
+
+public:
+    explicit DeadlineScheduler(double period);
+
+    // Starts the schedule with the first deadline one period from now.
+    void start();
+
+    // Time left until the next deadline [s], negative if it has passed.
+    double remaining() const;
+
+    // Sleeps until the next deadline. Returns how late the wake-up was [s].
+    double wait();
+
+    // Ends the current cycle and moves on to the next deadline. Returns the number of deadlines
+    // missed because the cycle overran.
+    std::uint64_t complete();
+
+    const Statistics& statistics() const { return m_statistics; }
+    void reset_statistics() { m_statistics = Statistics{}; }
+
+private:
+    static std::int64_t now();
+
+private:
+    const std::int64_t m_period;
+    std::int64_t m_deadline = 0;
+    Statistics m_statistics;
+};
+
+} // namespace pet::realtime
+
+#endif // PET_LOCALISATION_REALTIME_H
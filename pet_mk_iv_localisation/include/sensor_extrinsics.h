@@ -0,0 +1,29 @@
+#ifndef PET_LOCALISATION_SENSOR_EXTRINSICS_H
+#define PET_LOCALISATION_SENSOR_EXTRINSICS_H
+
+#include <geometry_msgs/Transform.h>
+
+#include <ugl/math/vector.h>
+#include <ugl/math/matrix.h>
+
+namespace pet
+{
+
+// Static mounting of a sensor on the body, resolved once from TF and then used as constants.
+struct SensorExtrinsics
+{
+    SensorExtrinsics() = default;
+
+    // From the transform of the sensor frame expressed in the base frame.
+    explicit SensorExtrinsics(const geometry_msgs::Transform& transform);
+
+    // Rotation from the sensor frame to the base frame.
+    ugl::Matrix<3,3> rotation = ugl::Matrix<3,3>::Identity();
+
+    // Position of the sensor in the base frame [m].
+    ugl::Vector3 lever_arm = ugl::Vector3::Zero();
+};
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_SENSOR_EXTRINSICS_H
@@ -0,0 +1,175 @@
+#ifndef PET_LOCALISATION_SHADOW_FILTER_H
+#define PET_LOCALISATION_SHADOW_FILTER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include <ros/time.h>
+
+#include <ugl/math/vector.h>
+
+#include "kalman_filter.h"
+
+namespace pet
+{
+
+// Second filter with an alternative configuration, run on a SCHED_IDLE thread for A/B evaluation
+// against the production filter. The production thread forwards every filter step it takes and,
+// once per cycle, its resulting state; the shadow replays the steps with its own configuration
+// and reports how far it has drifted from that state.
+//
+// Forwarding never blocks or allocates: steps go into a fixed-size single-producer ring buffer.
+// While the shadow is too far behind to take more, steps are dropped until the next state fits,
+// and the shadow restarts from that state. Reports go the other way through a seqlocked slot, so
+// the shadow thread never takes a lock which the production thread might wait for.
+class ShadowFilter
+{
+public:
+    static constexpr int kMaxSonars = 3;
+
+    struct Config
+    {
+        KalmanFilter::ProcessNoise process_noise;
+        // Factor on the variances of sonar velocity observations.
+        double sonar_variance_scale = 1.0;
+    };
+
+    // Outcome of one comparison with the production state.
+    struct Report
+    {
+        ros::Time stamp;
+
+        // Shadow state [theta, vel x, vel y, pos x, pos y].
+        double state[5];
+
+        double position = 0.0;
+        double heading = 0.0;
+        double velocity = 0.0;
+        // Squared state difference weighted by the inverse production covariance.
+        double normalised = 0.0;
+        // Largest position distance since the last restart.
+        double max_position = 0.0;
+
+        // CPU share of the shadow thread since the previous report.
+        double cpu_share = 0.0;
+        std::uint64_t dropped = 0;
+        std::uint32_t resyncs = 0;
+    };
+
+    static_assert(std::is_trivially_copyable<Report>::value, "Reports are copied word by word through the seqlock.");
+
+public:
+    // Starts from the state of initial. The shadow thread drains its input every poll_period [s].
+    ShadowFilter(const KalmanFilter& initial, const Config& config, std::size_t capacity, double poll_period);
+    ~ShadowFilter();
+
+    ShadowFilter(const ShadowFilter&) = delete;
+    ShadowFilter& operator=(const ShadowFilter&) = delete;
+
+    // Steps taken by the production filter, see KalmanFilter. Only to be called from one thread.
+    void predict(double dt, const ugl::Vector3& acc, const ugl::Vector3& ang_vel);
+    void command_predict(double dt, double linear_vel, double angular_vel);
+    // Fused update of count sonar velocities together with the lateral pseudo-observation.
+    void sonar_velocity_update(int count, const ugl::Vector<kMaxSonars>& velocities,
+                               const ugl::Vector<kMaxSonars>& directions, const ugl::Vector<kMaxSonars>& variances);
+    void zero_velocity_update();
+
+    // State of the production filter after the steps forwarded so far.
+    void compare(const ros::Time& stamp, const KalmanFilter& primary);
+
+    // CPU time used by the shadow thread [s], safe to read from any thread.
+    double cpu_time() const { return m_cpu_time.load(std::memory_order_relaxed); }
+
+    // Copies the latest report. Returns false when there is none newer than the one copied by the
+    // previous call, or when the shadow kept writing through kMaxReadAttempts tries. Never blocks,
+    // but only to be called from one thread.
+    bool latest_report(Report& report);
+
+private:
+    struct Predict
+    {
+        double dt;
+        ugl::Vector3 acc;
+        ugl::Vector3 ang_vel;
+    };
+
+    struct CommandPredict
+    {
+        double dt;
+        double linear_vel;
+        double angular_vel;
+    };
+
+    struct SonarVelocityUpdate
+    {
+        int count;
+        ugl::Vector<kMaxSonars> velocities;
+        ugl::Vector<kMaxSonars> directions;
+        ugl::Vector<kMaxSonars> variances;
+    };
+
+    struct ZeroVelocityUpdate {};
+
+    struct Compare
+    {
+        ros::Time stamp;
+        // Steps were dropped before this one, so the shadow restarts from it instead.
+        bool resync;
+        ugl::Vector<5> state;
+        KalmanFilter::Covariance<5> covariance;
+    };
+
+    using Input = std::variant<Predict, CommandPredict, SonarVelocityUpdate, ZeroVelocityUpdate, Compare>;
+
+    bool push(const Input& input);
+
+    void run();
+    void drain();
+    void apply(const Input& input);
+    void evaluate(const Compare& primary);
+    void store_report(const Report& report);
+
+private:
+    KalmanFilter m_filter;
+    const Config m_config;
+    const std::chrono::duration<double> m_poll_period;
+
+    // Single-producer single-consumer ring buffer. Indices only ever grow, the slot is index % size.
+    std::vector<Input> m_inputs;
+    std::atomic<std::size_t> m_head{0};
+    std::atomic<std::size_t> m_tail{0};
+
+    // Producer side: steps are being dropped until a state fits.
+    bool m_dropping = false;
+    std::atomic<std::uint64_t> m_dropped{0};
+
+    // Consumer side.
+    std::uint32_t m_resyncs = 0;
+    double m_max_position = 0.0;
+    double m_report_cpu_time = 0.0;
+    std::chrono::steady_clock::time_point m_report_time;
+    std::atomic<double> m_cpu_time{0.0};
+
+    // Latest report, guarded by a seqlock as in PoseChannelLayout. The sequence is odd while the
+    // shadow thread writes.
+    static constexpr std::size_t kReportWords = (sizeof(Report) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+    static constexpr int kMaxReadAttempts = 64;
+    std::atomic<std::uint64_t> m_report_sequence{0};
+    std::array<std::atomic<std::uint64_t>, kReportWords> m_report_words{};
+    // Reader side: sequence of the latest report copied out.
+    std::uint64_t m_report_read = 0;
+
+    std::atomic<bool> m_stop{false};
+    std::thread m_thread;
+};
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_SHADOW_FILTER_H
@@ -2,6 +2,9 @@
 #define PET_LOCALISATION_SONAR_MEASUREMENT_H
 
 #include <pet_mk_iv_msgs/DistanceMeasurement.h>
+#include <sensor_msgs/Range.h>
+
+#include <ros/time.h>
 
 #include "measurement.h"
 
@@ -11,18 +14,27 @@ namespace pet
 class SonarMeasurement: public Measurement
 {
 public:
-    SonarMeasurement(const pet_mk_iv_msgs::DistanceMeasurement& sonar_msg);
+    // The stamp replaces the one in the message, e.g. after correcting it for clock offset.
+    SonarMeasurement(const pet_mk_iv_msgs::DistanceMeasurement& sonar_msg, int sensor_index, const ros::Time& stamp);
+    SonarMeasurement(const sensor_msgs::Range& range_msg, int sensor_index, const ros::Time& stamp);
 
-    // Distance measured by sonar.
+    // Distance measured by sonar [m].
     double distance() const
     {
         return m_distance;
     }
 
+    // Index of the sonar, among the configured range sensors, which made the measurement.
+    int sensor_index() const
+    {
+        return m_sensor_index;
+    }
+
 private:
     double m_distance;
+    int m_sensor_index;
 };
 
 } // namespace pet
 
-#endif // PET_LOCALISATION_SONAR_MEASUREMENT_H
\ No newline at end of file
+#endif // PET_LOCALISATION_SONAR_MEASUREMENT_H
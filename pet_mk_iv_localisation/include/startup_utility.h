@@ -2,48 +2,56 @@
 #define PET_STARTUP_UTILITY_H
 
 #include <string>
+#include <vector>
 
 #include <ros/ros.h>
 
 namespace pet::utility
 {
 
-template<typename MsgType>
-void wait_for_message(const ros::Subscriber& subscriber,
-                      ros::Duration interval=ros::Duration(5.0),
-                      ros::Duration initial_duration=ros::Duration(2.0)
-                      )
+// Waits for the first message on any number of topics concurrently, under one common deadline.
+// Readiness is signalled from the node's own subscriber callbacks, so no extra subscriptions are
+// made and nothing blocks; the owner polls check() until it returns true.
+class ReadinessBarrier
 {
-    const std::string msg_type_name = ros::message_traits::DataType<MsgType>::value();
-    const std::string topic_name = subscriber.getTopic();
+public:
+    // Adds a topic to wait for and returns its index, to be passed to notify().
+    int add(const std::string& topic);
 
-    auto msg_ptr = ros::topic::waitForMessage<MsgType>(topic_name, initial_duration);
-    if (msg_ptr == nullptr)
-    {
-        ROS_WARN("No message recieved on topic [%s] with type [%s]!", topic_name.c_str(), msg_type_name.c_str());
-    }
-    else
-    {
-        return;
-    }
+    // Starts waiting. Topics not ready within the timeout are reported and then ignored.
+    void start(const ros::Time& now, const ros::Duration& timeout);
 
-    while (ros::ok())
+    // Signals that a message has been received on the topic.
+    void notify(int index, const ros::Time& now)
     {
-        auto msg_ptr = ros::topic::waitForMessage<MsgType>(topic_name, interval);
-        if (msg_ptr == nullptr)
-        {
-            ROS_INFO("Still waiting for message on topic [%s] with type [%s].", topic_name.c_str(), msg_type_name.c_str());
-        }
-        else
+        if (!m_topics[index].ready)
         {
-            ROS_INFO("Finally recieved a message on topic [%s] with type [%s]!", topic_name.c_str(), msg_type_name.c_str());
-            break;
+            m_topics[index].ready = true;
+            m_topics[index].ready_time = now;
         }
     }
 
-    return;
-}
+    // Returns true when all topics are ready or the deadline has passed.
+    // Readiness of every topic is reported the first time it returns true.
+    bool check(const ros::Time& now);
+
+private:
+    struct Topic
+    {
+        std::string name;
+        bool ready = false;
+        ros::Time ready_time;
+    };
+
+    void report(const ros::Time& now) const;
+
+private:
+    std::vector<Topic> m_topics;
+    ros::Time m_start;
+    ros::Time m_deadline;
+    bool m_passed = false;
+};
 
 }
 
-#endif // PET_STARTUP_UTILITY_H
\ No newline at end of file
+#endif // PET_STARTUP_UTILITY_H
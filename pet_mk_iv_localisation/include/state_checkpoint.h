@@ -0,0 +1,82 @@
+#ifndef PET_LOCALISATION_STATE_CHECKPOINT_H
+#define PET_LOCALISATION_STATE_CHECKPOINT_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include <ros/time.h>
+
+#include "kalman_filter.h"
+
+namespace pet
+{
+
+// Checkpoint of the filter state in a small memory-mapped file, used to resume after a restart.
+// The file holds two slots which are written alternately, so a crash in the middle of a save
+// always leaves the previous checkpoint intact. Saving is plain stores into the mapping.
+class StateCheckpoint
+{
+public:
+    struct Checkpoint
+    {
+        ros::Time stamp;
+        KalmanFilter filter;
+    };
+
+public:
+    StateCheckpoint() = default;
+    ~StateCheckpoint();
+
+    StateCheckpoint(const StateCheckpoint&) = delete;
+    StateCheckpoint& operator=(const StateCheckpoint&) = delete;
+
+    // Maps the checkpoint file, creating it if it does not exist. Returns false on failure.
+    bool open(const std::string& path);
+
+    bool is_open() const
+    {
+        return m_file != nullptr;
+    }
+
+    // Returns the latest valid checkpoint, if there is one.
+    std::optional<Checkpoint> load() const;
+
+    void save(const ros::Time& stamp, const KalmanFilter& filter);
+
+private:
+    static constexpr std::uint32_t kMagic = 0x50455443; // "PETC"
+    static constexpr std::uint32_t kVersion = 1;
+
+    struct Slot
+    {
+        std::uint64_t sequence;
+        std::uint64_t stamp;
+        double heading;
+        double velocity[2];
+        double position[2];
+        double covariance[5*5];
+        std::uint64_t checksum;
+    };
+
+    struct File
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        Slot slots[2];
+    };
+
+    static std::uint64_t checksum(const Slot& slot);
+    static bool is_valid(const Slot& slot);
+
+    // Returns the valid slot with the highest sequence number, or nullptr.
+    const Slot* latest_slot() const;
+
+private:
+    File* m_file = nullptr;
+    std::uint64_t m_sequence = 0;
+};
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_STATE_CHECKPOINT_H
@@ -0,0 +1,52 @@
+#ifndef PET_LOCALISATION_STATE_LOG_FORMAT_H
+#define PET_LOCALISATION_STATE_LOG_FORMAT_H
+
+#include <cstdint>
+#include <type_traits>
+
+namespace pet
+{
+
+// On-disk layout of the binary filter state log. The file is a StateLogHeader followed by
+// record_count fixed-size StateLogRecords. Any change to either struct must bump kVersion.
+struct StateLogHeader
+{
+    static constexpr std::uint32_t kMagic = 0x5045544C; // "PETL"
+    static constexpr std::uint32_t kVersion = 1;
+
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint32_t record_size;
+    // Number of complete records. Written after each record, so a crashed log is still readable.
+    std::uint64_t record_count;
+    // Wall time at which the log was created [ns].
+    std::int64_t created;
+};
+
+struct StateLogRecord
+{
+    // Filter time of the step [ns].
+    std::int64_t stamp;
+    // State [theta, vel x, vel y, pos x, pos y] and the diagonal of its covariance.
+    double state[5];
+    double covariance_diagonal[5];
+    // Leading innovation_size elements of the latest innovation, and its normalised squared norm.
+    double innovation[4];
+    double innovation_nis;
+    // Duration of the filter step and age of the oldest queued measurement [s].
+    double processing_time;
+    double queue_latency;
+    std::uint16_t queue_depth;
+    std::uint8_t innovation_size;
+    std::uint8_t reserved[5];
+};
+
+static_assert(std::is_trivially_copyable_v<StateLogHeader> && sizeof(StateLogHeader) == 32,
+              "State log header layout is part of the file format.");
+static_assert(std::is_trivially_copyable_v<StateLogRecord> && sizeof(StateLogRecord) == 152,
+              "State log record layout is part of the file format.");
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_STATE_LOG_FORMAT_H
@@ -0,0 +1,79 @@
+#ifndef PET_LOCALISATION_STATE_LOG_READER_H
+#define PET_LOCALISATION_STATE_LOG_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "state_log_format.h"
+
+namespace pet
+{
+
+// Reader of the binary filter state log. Records are read through a window which is mapped
+// over the file piece by piece, so logs far larger than memory (or the 32-bit address space
+// of the robot) can be streamed. Does not depend on ROS, so it can be used on any machine.
+class StateLogReader
+{
+public:
+    StateLogReader() = default;
+    ~StateLogReader();
+
+    StateLogReader(const StateLogReader&) = delete;
+    StateLogReader& operator=(const StateLogReader&) = delete;
+
+    // Opens an existing log. On failure returns false and error() tells why.
+    bool open(const std::string& path);
+    void close();
+
+    const std::string& error() const { return m_error; }
+    const StateLogHeader& header() const { return m_header; }
+
+    // Number of complete records in the log.
+    std::uint64_t size() const { return m_size; }
+
+    // Calls f(index, record) for every record in [first, last), in order.
+    template<typename F>
+    bool for_each(F&& f, std::uint64_t first = 0, std::uint64_t last = UINT64_MAX);
+
+private:
+    // Maps the window containing record index. Returns a pointer to it, or nullptr on failure.
+    const StateLogRecord* map_window(std::uint64_t index);
+
+private:
+    int m_fd = -1;
+    std::string m_error;
+    StateLogHeader m_header{};
+    std::uint64_t m_size = 0;
+
+    const void* m_window = nullptr;
+    std::size_t m_window_size = 0;
+    std::uint64_t m_window_offset = 0;
+
+    // Number of records in the window (and so the amount of memory mapped) at once.
+    static constexpr std::uint64_t kWindowRecords = 1 << 16;
+};
+
+template<typename F>
+bool StateLogReader::for_each(F&& f, std::uint64_t first, std::uint64_t last)
+{
+    last = (last < m_size) ? last : m_size;
+    for (std::uint64_t index = first; index < last; )
+    {
+        const StateLogRecord* records = map_window(index);
+        if (records == nullptr) {
+            return false;
+        }
+
+        const std::uint64_t window_end = (index / kWindowRecords + 1) * kWindowRecords;
+        const std::uint64_t end = (window_end < last) ? window_end : last;
+        for (const StateLogRecord* record = records; index < end; ++index, ++record) {
+            f(index, *record);
+        }
+    }
+    return true;
+}
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_STATE_LOG_READER_H
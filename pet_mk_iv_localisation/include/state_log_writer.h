@@ -0,0 +1,59 @@
+#ifndef PET_LOCALISATION_STATE_LOG_WRITER_H
+#define PET_LOCALISATION_STATE_LOG_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "state_log_format.h"
+
+namespace pet
+{
+
+// Append-only writer of the binary filter state log. Records are stored straight into a
+// memory-mapped window at the end of the file, which is grown and moved a chunk at a time so
+// that appending rarely touches the file system and the log may outgrow the address space.
+// The file is trimmed to its records when closed.
+class StateLogWriter
+{
+public:
+    StateLogWriter() = default;
+    ~StateLogWriter();
+
+    StateLogWriter(const StateLogWriter&) = delete;
+    StateLogWriter& operator=(const StateLogWriter&) = delete;
+
+    // Creates a new log, replacing any existing file. Returns false on failure.
+    bool open(const std::string& path);
+    void close();
+
+    bool is_open() const
+    {
+        return m_header != nullptr;
+    }
+
+    void append(const StateLogRecord& record);
+
+private:
+    // Grows the file and maps the window starting at record index first.
+    bool map_window(std::uint64_t first);
+
+private:
+    int m_fd = -1;
+    std::string m_path;
+
+    StateLogHeader* m_header = nullptr;
+
+    StateLogRecord* m_window = nullptr;
+    void* m_window_address = nullptr;
+    // Records [m_window_first, m_window_end) fit in the window.
+    std::uint64_t m_window_first = 0;
+    std::uint64_t m_window_end = 0;
+
+    // Size of the window, and so the amount the file is grown by at a time [bytes].
+    static constexpr std::size_t kChunkSize = 4 << 20;
+};
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_STATE_LOG_WRITER_H
@@ -0,0 +1,52 @@
+#ifndef PET_LOCALISATION_STATIONARY_DETECTOR_H
+#define PET_LOCALISATION_STATIONARY_DETECTOR_H
+
+#include <array>
+#include <vector>
+
+#include <ugl/math/vector.h>
+
+namespace pet
+{
+
+// Detects standstill from the latest imu samples. The robot is still when neither the
+// accelerometer nor the gyroscope vary more than their noise over a full window, and it
+// does not turn. Driving at constant velocity looks the same to the imu, so this should
+// be combined with another source such as the commanded motion.
+class StationaryDetector
+{
+public:
+    StationaryDetector() = default;
+
+    // acc_variance [(m/s^2)^2] and rate_variance [(rad/s)^2] are summed over all three axes.
+    StationaryDetector(int window, double acc_variance, double rate_variance, double max_rate);
+
+    void add(const ugl::Vector3& acc, const ugl::Vector3& rate);
+    void reset();
+
+    bool is_stationary() const { return m_stationary; }
+
+private:
+    using Sample = std::array<double, 6>;
+
+    void evaluate();
+
+private:
+    std::vector<Sample> m_samples;
+    int m_next = 0;
+    int m_count = 0;
+
+    // Sums of the samples and of their squares, per axis.
+    Sample m_sum{};
+    Sample m_sum_squares{};
+
+    double m_acc_variance = 0.0;
+    double m_rate_variance = 0.0;
+    double m_max_rate = 0.0;
+
+    bool m_stationary = false;
+};
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_STATIONARY_DETECTOR_H
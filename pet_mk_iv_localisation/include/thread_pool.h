@@ -0,0 +1,65 @@
+#ifndef PET_LOCALISATION_THREAD_POOL_H
+#define PET_LOCALISATION_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pet
+{
+
+// Fixed-size work-stealing thread pool. Each worker has its own task deque, taking its own newest
+// task first and stealing the oldest task of another worker when it runs out of work.
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+public:
+    // Zero threads means one per hardware core.
+    explicit ThreadPool(int num_threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(Task task);
+
+    // Runs all submitted tasks to completion and joins the workers.
+    void stop();
+
+    int size() const
+    {
+        return static_cast<int>(m_threads.size());
+    }
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(int index);
+    bool try_pop(int index, Task& task);
+
+private:
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake;
+    int m_queued = 0;
+    bool m_stop = false;
+
+    std::atomic<unsigned> m_next_worker{0};
+};
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_THREAD_POOL_H
@@ -0,0 +1,44 @@
+#ifndef PET_LOCALISATION_TRACEPOINTS_H
+#define PET_LOCALISATION_TRACEPOINTS_H
+
+// Static (USDT) tracepoints of the localisation hot path, for use with perf, bpftrace or LTTng.
+// Probes are only compiled in when PET_LOCALISATION_TRACING is defined, see the CMake option
+// of the same name, and cost a single nop each when no tracer is attached. Otherwise the
+// arguments are not evaluated at all.
+//
+// All probes belong to the provider pet_localisation, scripts using them are found in trace/.
+// Stamps are passed in nanoseconds of ROS time, durations are measured by the tracer.
+
+#if defined(PET_LOCALISATION_TRACING)
+#include <sys/sdt.h>
+#define PET_TRACE(name, ...) STAP_PROBEV(pet_localisation, name, __VA_ARGS__)
+#else
+// Arguments are still named in an unevaluated context, so values computed only for tracing stay "used".
+#define PET_TRACE(name, ...) static_cast<void>(sizeof(pet::trace::unused(__VA_ARGS__)))
+#endif
+
+namespace pet::trace
+{
+
+// Measurement kind, passed to drain_begin and drain_end.
+enum Kind : int
+{
+    kImu = 0,
+    kSonar = 1,
+    kCommand = 2,
+};
+
+// Published output, passed to publish_begin and publish_end.
+enum Output : int
+{
+    kTf = 0,
+    kPose = 1,
+    kVelocity = 2,
+};
+
+template<typename... Args>
+char unused(const Args&...);
+
+} // namespace pet::trace
+
+#endif // PET_LOCALISATION_TRACEPOINTS_H
@@ -68,7 +68,7 @@ class MPU6050(object):
             # Create msg
             msg = Imu()
             msg.header.stamp = rospy.Time.now()
-            msg.header.frame_id = "imu_frame"
+            msg.header.frame_id = "imu_link"
 
             msg.linear_acceleration.x = linear_acc[0]
             msg.linear_acceleration.y = linear_acc[1]
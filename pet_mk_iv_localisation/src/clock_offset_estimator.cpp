@@ -0,0 +1,107 @@
+#include "clock_offset_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <ros/time.h>
+
+namespace pet
+{
+
+ros::Time ClockOffsetEstimator::correct(const ros::Time& remote_stamp, const ros::Time& local_arrival)
+{
+    if (m_count == 0) {
+        reset(remote_stamp, local_arrival);
+    }
+
+    const double x = (remote_stamp - m_remote_reference).toSec();
+    const double y = (local_arrival - m_local_reference).toSec();
+
+    if (m_count >= kMinSamples && std::abs(y - (m_intercept + m_skew * x)) > kResetThreshold)
+    {
+        reset(remote_stamp, local_arrival);
+        return correct(remote_stamp, local_arrival);
+    }
+
+    add_sample(x, y);
+
+    if (m_count < kMinSamples) {
+        return remote_stamp;
+    }
+
+    fit();
+    m_offset = (m_local_reference - m_remote_reference).toSec() + (m_intercept + m_skew * x) - x;
+
+    // Never later than the arrival, which the fit guarantees up to rounding.
+    const double local = std::min(m_intercept + m_skew * x, y);
+    return m_local_reference + ros::Duration{local};
+}
+
+void ClockOffsetEstimator::reset(const ros::Time& remote_stamp, const ros::Time& local_arrival)
+{
+    m_remote_reference = remote_stamp;
+    m_local_reference = local_arrival;
+    m_next = 0;
+    m_count = 0;
+    m_sum_x = m_sum_y = m_sum_xx = m_sum_xy = 0.0;
+    m_intercept = 0.0;
+    m_skew = 1.0;
+}
+
+void ClockOffsetEstimator::add_sample(double x, double y)
+{
+    if (m_count == kWindowSize)
+    {
+        const double old_x = m_x[m_next];
+        const double old_y = m_y[m_next];
+        m_sum_x  -= old_x;
+        m_sum_y  -= old_y;
+        m_sum_xx -= old_x * old_x;
+        m_sum_xy -= old_x * old_y;
+    }
+    else
+    {
+        ++m_count;
+    }
+
+    m_x[m_next] = x;
+    m_y[m_next] = y;
+    m_sum_x  += x;
+    m_sum_y  += y;
+    m_sum_xx += x * x;
+    m_sum_xy += x * y;
+
+    m_next = (m_next + 1) % kWindowSize;
+
+    // Recompute the sums once per lap of the window so that rounding errors do not accumulate.
+    if (m_next == 0)
+    {
+        m_sum_x = m_sum_y = m_sum_xx = m_sum_xy = 0.0;
+        for (int i = 0; i < m_count; ++i)
+        {
+            m_sum_x  += m_x[i];
+            m_sum_y  += m_y[i];
+            m_sum_xx += m_x[i] * m_x[i];
+            m_sum_xy += m_x[i] * m_y[i];
+        }
+    }
+}
+
+void ClockOffsetEstimator::fit()
+{
+    const double n = m_count;
+    const double denominator = n * m_sum_xx - m_sum_x * m_sum_x;
+
+    // Samples too close in time to tell skew apart from noise, assume equal rates.
+    m_skew = (std::abs(denominator) > 1e-9) ? (n * m_sum_xy - m_sum_x * m_sum_y) / denominator : 1.0;
+
+    // Place the line on the sample with the lowest transport delay.
+    double min_residual = m_y[0] - m_skew * m_x[0];
+    for (int i = 1; i < m_count; ++i)
+    {
+        min_residual = std::min(min_residual, m_y[i] - m_skew * m_x[i]);
+    }
+    m_intercept = min_residual;
+}
+
+} // namespace pet
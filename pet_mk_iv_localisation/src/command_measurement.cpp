@@ -0,0 +1,35 @@
+#include "command_measurement.h"
+
+#include <algorithm>
+
+#include <geometry_msgs/TwistStamped.h>
+#include <pet_mk_iv_msgs/EngineCommand.h>
+
+#include "measurement.h"
+
+namespace pet
+{
+
+CommandMeasurement::CommandMeasurement(const pet_mk_iv_msgs::EngineCommand& engine_msg)
+    : Measurement(engine_msg.header.stamp)
+{
+    // Inverse of Controller.vel_to_pwm(), PWM values at or below the offset does not move the wheel.
+    const auto to_wheel_vel = [](int pwm, int direction) {
+        return direction * std::max(pwm - kPwmOffset, 0.0) / kPwmVelocityRatio;
+    };
+
+    const double left_wheel  = to_wheel_vel(engine_msg.left_pwm, engine_msg.left_direction);
+    const double right_wheel = to_wheel_vel(engine_msg.right_pwm, engine_msg.right_direction);
+
+    m_linear_vel  = (left_wheel + right_wheel) / 2;
+    m_angular_vel = (right_wheel - left_wheel) / kWheelBase;
+}
+
+CommandMeasurement::CommandMeasurement(const geometry_msgs::TwistStamped& twist_msg)
+    : Measurement(twist_msg.header.stamp)
+    , m_linear_vel(twist_msg.twist.linear.x)
+    , m_angular_vel(twist_msg.twist.angular.z)
+{
+}
+
+} // namespace pet
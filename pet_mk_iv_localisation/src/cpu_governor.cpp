@@ -0,0 +1,59 @@
+#include "cpu_governor.h"
+
+#include <chrono>
+
+#include <time.h>
+
+namespace pet
+{
+
+namespace
+{
+
+double cpu_time(clockid_t clock)
+{
+    timespec time;
+    clock_gettime(clock, &time);
+    return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) * 1e-9;
+}
+
+} // namespace
+
+CpuGovernor::CpuGovernor(double budget, double window)
+    : m_budget(budget)
+    , m_window(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{window}))
+    , m_window_start(Clock::now())
+{
+}
+
+bool CpuGovernor::update(double step_cpu_time)
+{
+    m_window_cpu_time += step_cpu_time;
+
+    const auto now = Clock::now();
+    if (now - m_window_start < m_window) {
+        return false;
+    }
+
+    const std::chrono::duration<double> elapsed = now - m_window_start;
+    m_share = m_window_cpu_time / elapsed.count();
+
+    m_window_start = now;
+    m_window_cpu_time = 0.0;
+
+    const int previous_level = m_level;
+    if (m_share > m_budget && m_level + 1 < static_cast<int>(kLevels.size())) {
+        ++m_level;
+    }
+    else if (m_share < m_budget * kRecoverFraction && m_level > 0) {
+        --m_level;
+    }
+    return m_level != previous_level;
+}
+
+double CpuGovernor::thread_cpu_time()
+{
+    return cpu_time(CLOCK_THREAD_CPUTIME_ID);
+}
+
+} // namespace pet
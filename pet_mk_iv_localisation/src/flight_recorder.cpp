@@ -0,0 +1,141 @@
+#include "flight_recorder.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include <ros/ros.h>
+
+namespace pet
+{
+
+namespace
+{
+
+const char* to_string(FlightRecorder::Record::Kind kind)
+{
+    switch (kind)
+    {
+    case FlightRecorder::Record::Kind::Imu:     return "imu";
+    case FlightRecorder::Record::Kind::Sonar:   return "sonar";
+    case FlightRecorder::Record::Kind::Command: return "command";
+    case FlightRecorder::Record::Kind::State:   return "state";
+    }
+    return "unknown";
+}
+
+// Keeps letters, digits and dashes, replaces anything else with underscores and trims them,
+// so that a namespace like /fleet/robot_1 becomes fleet_robot_1.
+std::string sanitise(const std::string& name)
+{
+    std::string result = name;
+    std::replace_if(result.begin(), result.end(), [](char c) { return !std::isalnum(static_cast<unsigned char>(c)) && c != '-'; }, '_');
+
+    const std::size_t first = result.find_first_not_of('_');
+    if (first == std::string::npos) {
+        return {};
+    }
+    return result.substr(first, result.find_last_not_of('_') - first + 1);
+}
+
+} // namespace
+
+FlightRecorder::FlightRecorder(double duration, double record_rate, const std::string& directory, const std::string& name)
+    : m_buffer(static_cast<std::size_t>(std::max(1.0, std::ceil(duration * record_rate))))
+    , m_directory(directory)
+    , m_name(sanitise(name))
+    , m_snapshot(m_buffer.size())
+    , m_writer(&FlightRecorder::run, this)
+{
+}
+
+FlightRecorder::~FlightRecorder()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_writer.join();
+}
+
+bool FlightRecorder::dump(const std::string& reason)
+{
+    if (m_writing.exchange(true)) {
+        return false;
+    }
+
+    // Oldest record first.
+    const std::size_t count = m_full ? m_buffer.size() : m_next;
+    const std::size_t begin = m_full ? m_next : 0;
+    std::rotate_copy(m_buffer.begin(), m_buffer.begin() + begin, m_buffer.begin() + count, m_snapshot.begin());
+    m_snapshot_count = count;
+
+    char stamp[32];
+    std::snprintf(stamp, sizeof(stamp), "%" PRIu64 "_", static_cast<std::uint64_t>(ros::WallTime::now().toSec()));
+    m_snapshot_path = m_directory + "/flight_recorder_" + (m_name.empty() ? "" : m_name + "_") + stamp + reason + ".csv";
+
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_pending = true;
+    }
+    m_wake.notify_one();
+    return true;
+}
+
+void FlightRecorder::wait()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_written.wait(lock, [this] { return !m_writing; });
+}
+
+void FlightRecorder::run()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    while (true)
+    {
+        // A pending dump is still written when stopping, such as the one made on shutdown.
+        m_wake.wait(lock, [this] { return m_pending || m_stop; });
+        if (!m_pending) {
+            return;
+        }
+        m_pending = false;
+
+        lock.unlock();
+        write();
+        lock.lock();
+
+        m_writing = false;
+        m_written.notify_all();
+    }
+}
+
+void FlightRecorder::write()
+{
+    const std::string& path = m_snapshot_path;
+    if (std::FILE* file = std::fopen(path.c_str(), "w"))
+    {
+        std::fprintf(file, "kind,sensor,queue_depth,stamp,v0,v1,v2,v3,v4,v5,v6,v7\n");
+        for (std::size_t i = 0; i < m_snapshot_count; ++i)
+        {
+            const Record& record = m_snapshot[i];
+            std::fprintf(file, "%s,%u,%u,%u.%09u", to_string(record.kind), record.sensor, record.queue_depth, record.stamp.sec, record.stamp.nsec);
+            for (const double value : record.values) {
+                std::fprintf(file, ",%.9g", value);
+            }
+            std::fprintf(file, "\n");
+        }
+        std::fclose(file);
+        ROS_INFO("Flight recorder dumped %zu records to [%s].", m_snapshot_count, path.c_str());
+    }
+    else
+    {
+        ROS_ERROR("Flight recorder could not open [%s] for writing.", path.c_str());
+    }
+}
+
+} // namespace pet
@@ -7,6 +7,8 @@
 #include <ugl_ros/convert_tf2.h>
 
 #include "measurement.h"
+#include "imu_sample.h"
+#include "sensor_extrinsics.h"
 
 namespace pet
 {
@@ -18,6 +20,32 @@ ImuMeasurement::ImuMeasurement(const sensor_msgs::Imu& imu_msg)
 {
 }
 
+ImuMeasurement::ImuMeasurement(const sensor_msgs::Imu& imu_msg, const SensorExtrinsics& extrinsics)
+    : ImuMeasurement(imu_msg.header.stamp, tf2::fromMsg(imu_msg.linear_acceleration), tf2::fromMsg(imu_msg.angular_velocity), extrinsics)
+{
+}
+
+ImuMeasurement::ImuMeasurement(const ImuSample& sample, const SensorExtrinsics& extrinsics)
+    : ImuMeasurement(sample.stamp, sample.linear_acceleration, sample.angular_velocity, extrinsics)
+{
+}
+
+ImuMeasurement::ImuMeasurement(const ros::Time& stamp, const ugl::Vector3& acc, const ugl::Vector3& rate)
+    : Measurement(stamp)
+    , m_acc(acc)
+    , m_rate(rate)
+{
+}
+
+ImuMeasurement::ImuMeasurement(const ros::Time& stamp, const ugl::Vector3& acc, const ugl::Vector3& rate, const SensorExtrinsics& extrinsics)
+    : Measurement(stamp)
+    , m_acc(extrinsics.rotation * acc)
+    , m_rate(extrinsics.rotation * rate)
+{
+    // An accelerometer off the rotation centre also measures the centripetal acceleration of its lever arm.
+    m_acc -= m_rate.cross(m_rate.cross(extrinsics.lever_arm));
+}
+
 const ugl::Vector3& ImuMeasurement::acceleration() const
 {
     return m_acc;
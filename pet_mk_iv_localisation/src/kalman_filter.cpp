@@ -1,11 +1,15 @@
 #include "kalman_filter.h"
 
 #include <cmath>
+#include <limits>
 
 #include <ugl/math/vector.h>
 #include <ugl/math/matrix.h>
 #include <ugl/lie_group/rotation2d.h>
 
+#include "kalman_filter_jacobians.h"
+#include "tracepoints.h"
+
 namespace pet
 {
 
@@ -18,6 +22,8 @@ KalmanFilter::KalmanFilter(double theta, const ugl::Vector<2>& position, const u
 
 void KalmanFilter::predict(double dt, const ugl::Vector3& acc, const ugl::Vector3& ang_vel)
 {
+    PET_TRACE(predict_begin, static_cast<long long>(dt * 1e9));
+
     const auto theta = heading();
     const auto vel   = velocity();
     const auto pos   = position();
@@ -31,58 +37,201 @@ void KalmanFilter::predict(double dt, const ugl::Vector3& acc, const ugl::Vector
     const ugl::Vector<2> new_pos = pos + (R * vel * dt) + (R * acc2d * 0.5*dt*dt);
 
     // Error propagation
-    const Jacobian<5,5> A = prediction_state_jacobian(dt, m_X, acc2d);
-    const Jacobian<5,3> B = prediction_noise_jacobian(dt, m_X);
+    const Jacobian<5,5> A = jacobians::prediction_state(dt, m_X, acc2d);
+    const Jacobian<5,3> B = jacobians::prediction_noise(dt, m_X);
 
-    // TODO: Estimate real noise values.
-    Covariance<3> Q_imu = Covariance<3>::Identity() * 0.1;
+    Covariance<3> Q_imu = Covariance<3>::Identity() * m_process_noise.imu;
 
     m_P = A*m_P*A.transpose() + B*Q_imu*B.transpose();
 
     set_heading(new_theta);
     set_position(new_pos);
     set_velocity(new_vel);
+
+    PET_TRACE(predict_end, static_cast<long long>(dt * 1e9));
+}
+
+void KalmanFilter::command_predict(double dt, double linear_vel, double angular_vel)
+{
+    PET_TRACE(command_predict_begin, static_cast<long long>(dt * 1e9));
+
+    const auto theta = heading();
+    const auto pos   = position();
+
+    const ugl::Vector<2> cmd_vel{linear_vel, 0.0};
+    const ugl::lie::Rotation2D R{theta};
+
+    // State propagation. The velocity is assumed to follow the command directly.
+    const double new_theta = theta + angular_vel * dt;
+    const ugl::Vector<2> new_pos = pos + (R * cmd_vel * dt);
+
+    // Error propagation
+    const Jacobian<5,5> A = jacobians::command_state(dt, m_X, cmd_vel);
+    const Jacobian<5,3> B = jacobians::command_noise(dt, m_X);
+
+    Covariance<3> Q_cmd = Covariance<3>::Identity() * m_process_noise.command;
+
+    m_P = A*m_P*A.transpose() + B*Q_cmd*B.transpose();
+
+    set_heading(new_theta);
+    set_position(new_pos);
+    set_velocity(cmd_vel);
+
+    PET_TRACE(command_predict_end, static_cast<long long>(dt * 1e9));
+}
+
+double KalmanFilter::process_batch(double start, const ImuBatch& imu, const SonarBatch& sonar, const BatchOutput& output)
+{
+    const auto lateral = pseudo_lateral_velocity_observation(0.0);
+    std::size_t next_sonar = 0;
+    bool updated = false;
+
+    const auto apply_sonar = [&](std::size_t predicted) {
+        for (; next_sonar < sonar.size && sonar.index[next_sonar] <= predicted; ++next_sonar)
+        {
+            updated = true;
+            const ugl::Vector<1> velocity = ugl::Vector<1>::Constant(sonar.velocity[next_sonar]);
+            const ugl::Vector<1> direction = ugl::Vector<1>::Constant(sonar.direction ? sonar.direction[next_sonar] : 0.0);
+            if (sonar.variance != nullptr) {
+                update(sonar_velocity_observation<1>(velocity, direction, ugl::Vector<1>::Constant(sonar.variance[next_sonar])), lateral);
+            }
+            else {
+                update(sonar_velocity_observation<1>(velocity, direction), lateral);
+            }
+        }
+    };
+
+    double previous = start;
+    apply_sonar(0);
+
+    for (std::size_t i = 0; i < imu.size; ++i)
+    {
+        const double dt = imu.stamp[i] - previous;
+        if (dt > 0.0)
+        {
+            predict(dt, ugl::Vector3{imu.acc_x[i], imu.acc_y[i], imu.acc_z[i]}, ugl::Vector3{imu.rate_x[i], imu.rate_y[i], imu.rate_z[i]});
+            previous = imu.stamp[i];
+        }
+        apply_sonar(i + 1);
+
+        if (output.states != nullptr) {
+            Eigen::Map<ugl::Vector<5>>(output.states + 5 * i) = m_X;
+        }
+        if (output.innovation_nis != nullptr) {
+            output.innovation_nis[i] = updated ? m_innovation_nis : std::numeric_limits<double>::quiet_NaN();
+        }
+        updated = false;
+    }
+
+    return previous;
 }
 
 void KalmanFilter::sonar_velocity_update(double velocity)
 {
-    Jacobian<1,5> H = Jacobian<1,5>::Zero();
-    H[kIndexVelX] = 1.0;
-    Jacobian<1,1> G = Jacobian<1,1>::Identity();
+    update(sonar_velocity_observation(velocity));
+}
+
+template<int n>
+void KalmanFilter::sonar_velocity_update(const ugl::Vector<n>& velocities, const ugl::Vector<n>& directions)
+{
+    update(sonar_velocity_observation<n>(velocities, directions));
+}
+
+void KalmanFilter::pseudo_lateral_velocity_update(double velocity)
+{
+    update(pseudo_lateral_velocity_observation(velocity));
+}
+
+void KalmanFilter::zero_velocity_update()
+{
+    update(zero_velocity_observation());
+}
+
+KalmanFilter::Observation<1> KalmanFilter::sonar_velocity_observation(double velocity)
+{
+    Observation<1> observation;
+    observation.z[0] = velocity;
+    observation.H = Jacobian<1,5>::Zero();
+    observation.H[kIndexVelX] = 1.0;
 
     // TODO: Estimate real noise values.
-    Covariance<1> Q_vel = Covariance<1>::Identity() * 0.1;
+    observation.R = Covariance<1>::Identity() * 0.1;
 
-    const Covariance<1> S = H*m_P*H.transpose() + G*Q_vel*G.transpose();
-    const ugl::Matrix<5,1> K = m_P*H.transpose()*S.inverse();
+    return observation;
+}
+
+template<int n>
+KalmanFilter::Observation<n> KalmanFilter::sonar_velocity_observation(const ugl::Vector<n>& velocities, const ugl::Vector<n>& directions)
+{
+    // TODO: Estimate real noise values.
+    return sonar_velocity_observation<n>(velocities, directions, ugl::Vector<n>::Constant(0.1));
+}
 
-    const double innovation = velocity - m_X[kIndexVelX];
+template<int n>
+KalmanFilter::Observation<n> KalmanFilter::sonar_velocity_observation(const ugl::Vector<n>& velocities, const ugl::Vector<n>& directions,
+                                                                      const ugl::Vector<n>& variances)
+{
+    Observation<n> observation;
+    observation.z = velocities;
+    observation.H = Jacobian<n,5>::Zero();
+    for (int i = 0; i < n; ++i)
+    {
+        observation.H(i, kIndexVelX) = std::cos(directions[i]);
+        observation.H(i, kIndexVelY) = std::sin(directions[i]);
+    }
 
-    m_X = m_X + K*innovation;
+    observation.R = variances.asDiagonal();
 
-    m_P = (Covariance<5>::Identity() - K*H) * m_P;
+    return observation;
 }
 
-void KalmanFilter::pseudo_lateral_velocity_update(double velocity)
+KalmanFilter::Observation<1> KalmanFilter::pseudo_lateral_velocity_observation(double velocity)
 {
-    Jacobian<1,5> H = Jacobian<1,5>::Zero();
-    H[kIndexVelY] = 1.0;
-    Jacobian<1,1> G = Jacobian<1,1>::Identity();
+    Observation<1> observation;
+    observation.z[0] = velocity;
+    observation.H = Jacobian<1,5>::Zero();
+    observation.H[kIndexVelY] = 1.0;
 
     // TODO: How certain certain should we claim to be?
-    Covariance<1> Q_vel = Covariance<1>::Identity() * 0.01;
+    observation.R = Covariance<1>::Identity() * 0.01;
 
-    const Covariance<1> S = H*m_P*H.transpose() + G*Q_vel*G.transpose();
-    const ugl::Matrix<5,1> K = m_P*H.transpose()*S.inverse();
+    return observation;
+}
 
-    const double innovation = velocity - m_X[kIndexVelY];
+KalmanFilter::Observation<2> KalmanFilter::zero_velocity_observation()
+{
+    Observation<2> observation;
+    observation.z = ugl::Vector<2>::Zero();
+    observation.H = Jacobian<2,5>::Zero();
+    observation.H(0, kIndexVelX) = 1.0;
+    observation.H(1, kIndexVelY) = 1.0;
 
-    m_X = m_X + K*innovation;
+    // Only made when imu and commands agree that the robot is parked, so claim to be quite sure.
+    observation.R = Covariance<2>::Identity() * 1e-4;
 
-    m_P = (Covariance<5>::Identity() - K*H) * m_P;
+    return observation;
 }
 
-KalmanFilter::Jacobian<5,5> KalmanFilter::prediction_state_jacobian(double dt, const ugl::Vector<5> X, const ugl::Vector<2>& acc)
+// One instantiation per possible number of sonars reporting in the same cycle.
+template void KalmanFilter::sonar_velocity_update<1>(const ugl::Vector<1>&, const ugl::Vector<1>&);
+template void KalmanFilter::sonar_velocity_update<2>(const ugl::Vector<2>&, const ugl::Vector<2>&);
+template void KalmanFilter::sonar_velocity_update<3>(const ugl::Vector<3>&, const ugl::Vector<3>&);
+
+template KalmanFilter::Observation<1> KalmanFilter::sonar_velocity_observation<1>(const ugl::Vector<1>&, const ugl::Vector<1>&);
+template KalmanFilter::Observation<2> KalmanFilter::sonar_velocity_observation<2>(const ugl::Vector<2>&, const ugl::Vector<2>&);
+template KalmanFilter::Observation<3> KalmanFilter::sonar_velocity_observation<3>(const ugl::Vector<3>&, const ugl::Vector<3>&);
+template KalmanFilter::Observation<1> KalmanFilter::sonar_velocity_observation<1>(const ugl::Vector<1>&, const ugl::Vector<1>&, const ugl::Vector<1>&);
+template KalmanFilter::Observation<2> KalmanFilter::sonar_velocity_observation<2>(const ugl::Vector<2>&, const ugl::Vector<2>&, const ugl::Vector<2>&);
+template KalmanFilter::Observation<3> KalmanFilter::sonar_velocity_observation<3>(const ugl::Vector<3>&, const ugl::Vector<3>&, const ugl::Vector<3>&);
+
+namespace jacobians
+{
+
+constexpr int kIndexTheta = KalmanFilter::kIndexTheta;
+constexpr int kIndexVelX = KalmanFilter::kIndexVelX;
+constexpr int kIndexPosX = KalmanFilter::kIndexPosX;
+
+ugl::Matrix<5,5> prediction_state(double dt, const ugl::Vector<5>& X, const ugl::Vector<2>& acc)
 {
     const double theta = X[kIndexTheta];
     const ugl::Vector<2> vel = X.segment<2>(kIndexVelX);
@@ -93,18 +242,45 @@ KalmanFilter::Jacobian<5,5> KalmanFilter::prediction_state_jacobian(double dt, c
     dRdtheta << -std::sin(theta), -std::cos(theta),
                  std::cos(theta), -std::sin(theta);
 
-    Jacobian<5,5> A = Jacobian<5,5>::Identity();
+    ugl::Matrix<5,5> A = ugl::Matrix<5,5>::Identity();
     A.block<2,1>(kIndexPosX, kIndexTheta) = dRdtheta * (vel*dt + 0.5*acc*dt*dt);
     A.block<2,2>(kIndexPosX, kIndexVelX)  = R.matrix() * dt;
     return A;
 }
 
-KalmanFilter::Jacobian<5,3> KalmanFilter::prediction_noise_jacobian(double dt, const ugl::Vector<5> X)
+ugl::Matrix<5,3> prediction_noise(double dt, const ugl::Vector<5>& X)
 {
     const ugl::lie::Rotation2D R{X[kIndexTheta]};
-    Jacobian<5,3> B = Jacobian<5,3>::Identity() * dt;
+    ugl::Matrix<5,3> B = ugl::Matrix<5,3>::Identity() * dt;
     B.block<2,2>(kIndexPosX, 1) = R.matrix() * 0.5*dt*dt;
     return B;
 }
 
+ugl::Matrix<5,5> command_state(double dt, const ugl::Vector<5>& X, const ugl::Vector<2>& cmd_vel)
+{
+    const double theta = X[kIndexTheta];
+
+    // Derivative of R with regards to theta.
+    ugl::Matrix<2,2> dRdtheta;
+    dRdtheta << -std::sin(theta), -std::cos(theta),
+                 std::cos(theta), -std::sin(theta);
+
+    ugl::Matrix<5,5> A = ugl::Matrix<5,5>::Identity();
+    A.block<2,2>(kIndexVelX, kIndexVelX) = ugl::Matrix<2,2>::Zero();
+    A.block<2,1>(kIndexPosX, kIndexTheta) = dRdtheta * cmd_vel * dt;
+    return A;
+}
+
+ugl::Matrix<5,3> command_noise(double dt, const ugl::Vector<5>& X)
+{
+    const ugl::lie::Rotation2D R{X[kIndexTheta]};
+    ugl::Matrix<5,3> B = ugl::Matrix<5,3>::Zero();
+    B(kIndexTheta, 0) = dt;
+    B.block<2,2>(kIndexVelX, 1) = ugl::Matrix<2,2>::Identity();
+    B.block<2,2>(kIndexPosX, 1) = R.matrix() * dt;
+    return B;
+}
+
+} // namespace jacobians
+
 } // namespace pet
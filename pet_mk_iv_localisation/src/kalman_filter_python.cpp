@@ -0,0 +1,234 @@
+// Python bindings of KalmanFilter and the measurement types, as the module
+// pet_mk_iv_localisation.kalman_filter. Stamps are given in seconds, vectors as NumPy arrays.
+//
+//   from pet_mk_iv_localisation.kalman_filter import KalmanFilter, run
+//
+//   kf = KalmanFilter(0.0, [0.0, 0.0], [0.0, 0.0])
+//   stamps, states = run(kf, imu_stamps, imu_acc, imu_rate, sonar_stamps, sonar_distances)
+//
+// run() processes whole recordings through KalmanFilter::process_batch, with the GIL released,
+// instead of one call per sample.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/eigen.h>
+#include <pybind11/numpy.h>
+
+#include <geometry_msgs/TwistStamped.h>
+#include <pet_mk_iv_msgs/EngineCommand.h>
+#include <ros/time.h>
+#include <sensor_msgs/Range.h>
+
+#include <ugl/math/vector.h>
+
+#include "kalman_filter.h"
+#include "imu_measurement.h"
+#include "sonar_measurement.h"
+#include "command_measurement.h"
+#include "range_rate_estimator.h"
+
+namespace py = pybind11;
+
+namespace pet
+{
+namespace
+{
+
+using Array = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+void check_shape(const Array& array, const char* name, py::ssize_t rows, py::ssize_t cols)
+{
+    const bool valid = (cols == 0) ? (array.ndim() == 1 && array.shape(0) == rows)
+                                   : (array.ndim() == 2 && array.shape(0) == rows && array.shape(1) == cols);
+    if (!valid) {
+        throw std::invalid_argument(std::string{name} + " does not match the number of stamps");
+    }
+}
+
+// Runs imu and sonar recordings through the filter the way kalman_node does: every imu sample
+// predicts, and once the sonar's range rate window holds enough samples, every sonar sample
+// updates the velocity with the range rate and its variance, together with the lateral
+// pseudo-observation. A gap of more than sonar_max_dt restarts the window. Both recordings must
+// be sorted by stamp. Returns the imu stamps and the state [theta, vel x, vel y, pos x, pos y]
+// after every imu sample.
+py::tuple run(KalmanFilter& filter,
+              const Array& imu_stamps, const Array& imu_acc, const Array& imu_rate,
+              const Array& sonar_stamps, const Array& sonar_distances,
+              double sonar_direction, double sonar_max_dt, int sonar_window)
+{
+    const py::ssize_t n = imu_stamps.ndim() == 1 ? imu_stamps.shape(0) : -1;
+    const py::ssize_t m = sonar_stamps.ndim() == 1 ? sonar_stamps.shape(0) : -1;
+    if (n < 0 || m < 0) {
+        throw std::invalid_argument("stamps must be one-dimensional");
+    }
+    check_shape(imu_acc, "imu_acc", n, 3);
+    check_shape(imu_rate, "imu_rate", n, 3);
+    check_shape(sonar_distances, "sonar_distances", m, 0);
+
+    // Structure of arrays for KalmanFilter::process_batch.
+    const auto count = static_cast<std::size_t>(n);
+    std::vector<double> imu_columns(6 * count);
+    const auto acc = imu_acc.unchecked<2>();
+    const auto rate = imu_rate.unchecked<2>();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        for (std::size_t axis = 0; axis < 3; ++axis)
+        {
+            imu_columns[axis * count + i] = acc(static_cast<py::ssize_t>(i), static_cast<py::ssize_t>(axis));
+            imu_columns[(axis + 3) * count + i] = rate(static_cast<py::ssize_t>(i), static_cast<py::ssize_t>(axis));
+        }
+    }
+
+    // Range rates, each placed after the imu samples up to its stamp.
+    const double* imu_t = imu_stamps.data();
+    const double* sonar_t = sonar_stamps.data();
+    const double* distance = sonar_distances.data();
+    std::vector<std::size_t> sonar_index;
+    std::vector<double> sonar_velocity;
+    std::vector<double> sonar_variance;
+    RangeRateEstimator range_rate{sonar_window};
+    for (py::ssize_t j = 0; j < m; ++j)
+    {
+        if (j > 0 && sonar_t[j] - sonar_t[j - 1] > sonar_max_dt) {
+            range_rate.reset();
+        }
+        range_rate.add(ros::Time{sonar_t[j]}, distance[j]);
+
+        if (range_rate.has_estimate())
+        {
+            sonar_index.push_back(static_cast<std::size_t>(std::upper_bound(imu_t, imu_t + n, sonar_t[j]) - imu_t));
+            sonar_velocity.push_back(-range_rate.rate());
+            sonar_variance.push_back(range_rate.variance());
+        }
+    }
+    const std::vector<double> sonar_directions(sonar_velocity.size(), sonar_direction);
+
+    Array stamps(n, imu_t);
+    Array states({n, py::ssize_t{5}});
+
+    KalmanFilter::ImuBatch imu;
+    imu.size = count;
+    imu.stamp = imu_t;
+    imu.acc_x = imu_columns.data();
+    imu.acc_y = imu.acc_x + count;
+    imu.acc_z = imu.acc_y + count;
+    imu.rate_x = imu.acc_z + count;
+    imu.rate_y = imu.rate_x + count;
+    imu.rate_z = imu.rate_y + count;
+
+    const KalmanFilter::SonarBatch sonar{sonar_velocity.size(), sonar_index.data(), sonar_velocity.data(), sonar_directions.data(), sonar_variance.data()};
+
+    KalmanFilter::BatchOutput output;
+    output.states = states.mutable_data();
+
+    {
+        py::gil_scoped_release release;
+        filter.process_batch(n > 0 ? imu_t[0] : 0.0, imu, sonar, output);
+    }
+
+    return py::make_tuple(stamps, states);
+}
+
+} // namespace
+} // namespace pet
+
+PYBIND11_MODULE(kalman_filter, m)
+{
+    using pet::KalmanFilter;
+    using pet::ImuMeasurement;
+    using pet::SonarMeasurement;
+    using pet::CommandMeasurement;
+
+    m.doc() = "Kalman filter of pet_mk_iv_localisation. State is [theta, vel x, vel y, pos x, pos y], velocity in the body frame.";
+
+    py::class_<KalmanFilter>(m, "KalmanFilter")
+        .def(py::init<>())
+        .def(py::init<double, const ugl::Vector<2>&, const ugl::Vector<2>&>(), py::arg("theta"), py::arg("position"), py::arg("velocity"))
+        .def_property("heading", &KalmanFilter::heading, &KalmanFilter::set_heading)
+        .def_property("velocity", &KalmanFilter::velocity, &KalmanFilter::set_velocity)
+        .def_property("position", &KalmanFilter::position, &KalmanFilter::set_position)
+        .def_property("covariance", &KalmanFilter::covariance, &KalmanFilter::set_covariance)
+        .def_property_readonly("innovation_nis", &KalmanFilter::innovation_nis)
+        .def_property_readonly("innovation", [](const KalmanFilter& filter) -> ugl::Vector<4> {
+            ugl::Vector<4> innovation = filter.innovation();
+            innovation.tail(4 - filter.innovation_size()).setZero();
+            return innovation;
+        })
+        .def_property_readonly("innovation_size", &KalmanFilter::innovation_size)
+        .def("predict", &KalmanFilter::predict, py::arg("dt"), py::arg("acc"), py::arg("angular_rate"))
+        .def("command_predict", &KalmanFilter::command_predict, py::arg("dt"), py::arg("linear_vel"), py::arg("angular_vel"))
+        .def("sonar_velocity_update", py::overload_cast<double>(&KalmanFilter::sonar_velocity_update), py::arg("velocity"))
+        .def("sonar_velocity_update", [](KalmanFilter& filter, const Eigen::VectorXd& velocities, const Eigen::VectorXd& directions) {
+            if (velocities.size() != directions.size()) {
+                throw std::invalid_argument("velocities and directions differ in length");
+            }
+            switch (velocities.size())
+            {
+            case 1:
+                filter.sonar_velocity_update<1>(velocities, directions);
+                break;
+            case 2:
+                filter.sonar_velocity_update<2>(velocities, directions);
+                break;
+            case 3:
+                filter.sonar_velocity_update<3>(velocities, directions);
+                break;
+            default:
+                throw std::invalid_argument("between 1 and 3 sonars can be fused at once");
+            }
+        }, py::arg("velocities"), py::arg("directions"))
+        .def("pseudo_lateral_velocity_update", &KalmanFilter::pseudo_lateral_velocity_update, py::arg("velocity") = 0.0)
+        .def("zero_velocity_update", &KalmanFilter::zero_velocity_update);
+
+    py::class_<ImuMeasurement>(m, "ImuMeasurement")
+        .def(py::init([](double stamp, const ugl::Vector3& acc, const ugl::Vector3& angular_rate) {
+            return ImuMeasurement{ros::Time{stamp}, acc, angular_rate};
+        }), py::arg("stamp"), py::arg("acc"), py::arg("angular_rate"))
+        .def_property_readonly("stamp", [](const ImuMeasurement& measurement) { return measurement.stamp().toSec(); })
+        .def_property_readonly("acceleration", &ImuMeasurement::acceleration)
+        .def_property_readonly("angular_rate", &ImuMeasurement::angular_rate);
+
+    py::class_<SonarMeasurement>(m, "SonarMeasurement")
+        .def(py::init([](double stamp, double distance, int sensor_index) {
+            sensor_msgs::Range msg;
+            msg.range = static_cast<float>(distance);
+            return SonarMeasurement{msg, sensor_index, ros::Time{stamp}};
+        }), py::arg("stamp"), py::arg("distance"), py::arg("sensor_index") = 0)
+        .def_property_readonly("stamp", [](const SonarMeasurement& measurement) { return measurement.stamp().toSec(); })
+        .def_property_readonly("distance", &SonarMeasurement::distance)
+        .def_property_readonly("sensor_index", &SonarMeasurement::sensor_index);
+
+    py::class_<CommandMeasurement>(m, "CommandMeasurement")
+        .def_static("from_engine_command", [](double stamp, int left_pwm, int right_pwm, int left_direction, int right_direction) {
+            pet_mk_iv_msgs::EngineCommand msg;
+            msg.header.stamp = ros::Time{stamp};
+            msg.left_pwm = static_cast<std::uint8_t>(left_pwm);
+            msg.right_pwm = static_cast<std::uint8_t>(right_pwm);
+            msg.left_direction = static_cast<std::int8_t>(left_direction);
+            msg.right_direction = static_cast<std::int8_t>(right_direction);
+            return CommandMeasurement{msg};
+        }, py::arg("stamp"), py::arg("left_pwm"), py::arg("right_pwm"), py::arg("left_direction"), py::arg("right_direction"))
+        .def_static("from_twist", [](double stamp, double linear_vel, double angular_vel) {
+            geometry_msgs::TwistStamped msg;
+            msg.header.stamp = ros::Time{stamp};
+            msg.twist.linear.x = linear_vel;
+            msg.twist.angular.z = angular_vel;
+            return CommandMeasurement{msg};
+        }, py::arg("stamp"), py::arg("linear_vel"), py::arg("angular_vel"))
+        .def_property_readonly("stamp", [](const CommandMeasurement& measurement) { return measurement.stamp().toSec(); })
+        .def_property_readonly("linear_velocity", &CommandMeasurement::linear_velocity)
+        .def_property_readonly("angular_velocity", &CommandMeasurement::angular_velocity);
+
+    m.def("run", &pet::run,
+          "Runs imu samples (stamps [s], acc and angular_rate as (n, 3) arrays) and sonar samples (stamps [s] and distances [m]), "
+          "both sorted by stamp, through the filter. Returns the imu stamps and (n, 5) states after every imu sample.",
+          py::arg("filter"), py::arg("imu_stamps"), py::arg("imu_acc"), py::arg("imu_rate"),
+          py::arg("sonar_stamps"), py::arg("sonar_distances"), py::arg("sonar_direction") = 0.0, py::arg("sonar_max_dt") = 0.2,
+          py::arg("sonar_window") = 5);
+}
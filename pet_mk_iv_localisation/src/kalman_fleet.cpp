@@ -0,0 +1,134 @@
+#include "kalman_fleet.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <ros/ros.h>
+
+#include "kalman_node.h"
+#include "pooled_callback_queue.h"
+#include "thread_pool.h"
+
+namespace pet
+{
+
+namespace
+{
+
+// Resident memory of the whole process [kB].
+long resident_memory_kb()
+{
+    long size = 0;
+    long resident = 0;
+    std::ifstream statm{"/proc/self/statm"};
+    statm >> size >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+} // namespace
+
+KalmanFleet::Robot::Robot(const std::string& name, ThreadPool& pool)
+    : name(name)
+    , queue(pool)
+    , nh(name)
+    , nh_private("~/" + name)
+{
+    nh.setCallbackQueue(&queue);
+    nh_private.setCallbackQueue(&queue);
+
+    // Keep the frames of different robots apart unless configured otherwise.
+    if (!nh_private.hasParam("base_frame")) {
+        nh_private.setParam("base_frame", name + "/base_link");
+    }
+    if (!nh_private.hasParam("imu_frame")) {
+        nh_private.setParam("imu_frame", name + "/imu_link");
+    }
+    for (const auto& sensor : nh_private.param<std::vector<std::string>>("range_sensors/names", {"mid"}))
+    {
+        const std::string frame_id = "range_sensors/" + sensor + "/frame_id";
+        if (!nh_private.hasParam(frame_id)) {
+            nh_private.setParam(frame_id, name + "/dist_sensor_" + sensor);
+        }
+    }
+}
+
+KalmanFleet::KalmanFleet(ros::NodeHandle& nh_private)
+    : m_nh_private(nh_private)
+    , m_pool(nh_private.param<int>("threads", 0))
+{
+    const auto names = m_nh_private.param<std::vector<std::string>>("robots", {});
+    if (names.empty()) {
+        ROS_ERROR("No robots configured. Set the parameter [%s].", m_nh_private.resolveName("robots").c_str());
+    }
+
+    for (const auto& name : names)
+    {
+        ROS_INFO("Initialising robot [%s]...", name.c_str());
+        const long memory_before = resident_memory_kb();
+
+        auto robot = std::make_unique<Robot>(name, m_pool);
+        robot->node = std::make_unique<KalmanNode>(robot->nh, robot->nh_private);
+        robot->memory_kb = resident_memory_kb() - memory_before;
+
+        m_robots.push_back(std::move(robot));
+    }
+
+    const double report_period = m_nh_private.param<double>("report_period", 10.0);
+    m_report_timer = m_nh_private.createWallTimer(ros::WallDuration{report_period}, &KalmanFleet::report_cb, this, false, false);
+
+    ROS_INFO("Hosting %zu robots on %d threads.", m_robots.size(), m_pool.size());
+}
+
+KalmanFleet::~KalmanFleet()
+{
+    // Callbacks must be done before the robots they belong to are destroyed.
+    m_pool.stop();
+}
+
+void KalmanFleet::start()
+{
+    // Callbacks are only run once their node is started.
+    for (auto& robot : m_robots)
+    {
+        robot->node->start();
+        robot->queue.start();
+    }
+    m_report_timer.start();
+}
+
+void KalmanFleet::report_cb(const ros::WallTimerEvent& e)
+{
+    const double period = (e.current_real - e.last_real).toSec();
+    if (period <= 0.0) {
+        return;
+    }
+
+    for (auto& robot : m_robots)
+    {
+        const int64_t cpu_time_ns = robot->queue.cpu_time().count();
+        const double cpu_share = (cpu_time_ns - robot->previous_cpu_time_ns) * 1e-9 / period;
+        robot->previous_cpu_time_ns = cpu_time_ns;
+
+        ROS_INFO("Robot [%s]: CPU %.1f%%, memory %ld kB.", robot->name.c_str(), 100.0 * cpu_share, robot->memory_kb);
+    }
+    ROS_INFO("Fleet: resident memory %ld kB in total.", resident_memory_kb());
+}
+
+} // namespace pet
+
+int main(int argc, char** argv)
+{
+    ros::init(argc, argv, "kalman_fleet");
+    ros::NodeHandle nh_private("~");
+
+    ROS_INFO("Initialising fleet...");
+    pet::KalmanFleet fleet(nh_private);
+    ROS_INFO("Fleet initialisation done.");
+
+    fleet.start();
+    ros::spin();
+}
@@ -2,14 +2,25 @@
 
 #include <string>
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 
 #include <ros/ros.h>
-#include <tf2_ros/transform_broadcaster.h>
+#include <ros/callback_queue.h>
+#include <tf2_ros/buffer.h>
 
 #include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/TwistStamped.h>
 #include <geometry_msgs/Vector3Stamped.h>
 #include <pet_mk_iv_msgs/DistanceMeasurement.h>
+#include <pet_mk_iv_msgs/EngineCommand.h>
 #include <sensor_msgs/Imu.h>
+#include <sensor_msgs/Range.h>
+#include <std_msgs/UInt8.h>
+#include <std_srvs/Trigger.h>
+#include <tf2_msgs/TFMessage.h>
 
 #include <ugl/math/vector.h>
 #include <ugl/math/quaternion.h>
@@ -19,7 +30,21 @@
 #include "kalman_filter.h"
 #include "measurement.h"
 #include "imu_measurement.h"
+#include "imu_sample.h"
 #include "sonar_measurement.h"
+#include "command_measurement.h"
+#include "clock_offset_estimator.h"
+#include "state_checkpoint.h"
+#include "sensor_extrinsics.h"
+#include "flight_recorder.h"
+#include "state_log_format.h"
+#include "state_log_writer.h"
+#include "pose_channel_format.h"
+#include "pose_channel_writer.h"
+#include "stationary_detector.h"
+#include "cpu_governor.h"
+#include "tracepoints.h"
+#include "realtime.h"
 
 #include "startup_utility.h"
 
@@ -30,41 +55,152 @@ const ros::Duration KalmanNode::kQueueMinLatency  = ros::Duration{0.005};
 const ros::Duration KalmanNode::kQueueMaxLatency  = ros::Duration{0.1};
 const ros::Duration KalmanNode::kImuMaxDuration   = ros::Duration{0.05};
 const ros::Duration KalmanNode::kSonarMaxDuration = ros::Duration{0.2};
+const double KalmanNode::kCallbackSlack = 0.0005;
 
 KalmanNode::KalmanNode(ros::NodeHandle& nh, ros::NodeHandle& nh_private)
     : m_nh(nh)
     , m_nh_private(nh_private)
     , m_base_frame(nh_private.param<std::string>("base_frame", "base_link"))
     , m_map_frame(nh_private.param<std::string>("map_frame", "map"))
+    , m_imu_frame(nh_private.param<std::string>("imu_frame", "imu_link"))
+    , m_period(1.0 / nh_private.param<double>("frequency", 10.0))
+    , m_flight_recorder(nh_private.param<double>("flight_recorder/duration", 30.0),
+                        nh_private.param<double>("flight_recorder/measurement_rate", 150.0) + 1.0 / m_period,
+                        nh_private.param<std::string>("flight_recorder/directory", "/tmp"),
+                        nh_private.param<std::string>("flight_recorder/name", nh.getNamespace()))
+    , m_flight_recorder_max_nis(nh_private.param<double>("flight_recorder/max_nis", 30.0))
+    , m_flight_recorder_cooldown(nh_private.param<double>("flight_recorder/cooldown", 30.0))
+    , m_queue_capacity(static_cast<std::size_t>(std::max(1, nh_private.param<int>("queue/capacity", kQueueCapacity))))
+    , m_stationary_detector(nh_private.param<int>("stationary/window", 50),
+                            nh_private.param<double>("stationary/acc_variance", 0.01),
+                            nh_private.param<double>("stationary/rate_variance", 1e-4),
+                            nh_private.param<double>("stationary/max_rate", 0.02))
+    , m_stationary_enabled(nh_private.param<bool>("stationary/enabled", true))
+    , m_stationary_require_command(nh_private.param<bool>("stationary/require_command", true))
+    , m_idle_publish_divisor(std::max(1, nh_private.param<int>("stationary/publish_divisor", 5)))
+    , m_queue_min_latency(nh_private.param<double>("queue/min_latency", kQueueMinLatency.toSec()))
+    , m_queue_max_latency(nh_private.param<double>("queue/max_latency", kQueueMaxLatency.toSec()))
 {
     // TODO: Make topics configurable through ROS parameters.
     m_imu_sub       = m_nh.subscribe("imu", 10, &KalmanNode::imu_cb, this);
-    m_sonar_sub     = m_nh.subscribe("dist_sensors", 10, &KalmanNode::sonar_cb, this);
+    m_imu_topic_index = m_readiness.add(m_imu_sub.getTopic());
+    m_tf_static_sub = m_nh.subscribe("/tf_static", 10, &KalmanNode::tf_static_cb, this);
+    m_tf_pub        = m_nh.advertise<tf2_msgs::TFMessage>("/tf", 100);
     m_pose_pub      = m_nh.advertise<geometry_msgs::PoseStamped>("pose_filtered", 10);
     m_velocity_pub  = m_nh.advertise<geometry_msgs::Vector3Stamped>("vel_filtered", 10);
+    m_dump_flight_recorder_srv = m_nh_private.advertiseService("dump_flight_recorder", &KalmanNode::dump_flight_recorder_cb, this);
 
-    const double frequency = m_nh_private.param<double>("frequency", 10.0);
-    m_timer = m_nh.createTimer(1.0/frequency, &KalmanNode::timer_cb, this, false, false);
+    m_timer = m_nh.createTimer(m_period, &KalmanNode::timer_cb, this, false, false);
 
+    load_range_sensors();
+    subscribe_command();
     initialise_kalman_filter();
+    load_overload_policy();
 
-    m_tf_msg.header.frame_id = m_map_frame;
-    m_tf_msg.child_frame_id = m_base_frame;
+    if (m_stationary_enabled && m_stationary_require_command && !m_command_sub)
+    {
+        ROS_INFO("Stationary idle mode needs a command source to tell standstill from constant motion. Disabled.");
+        m_stationary_enabled = false;
+    }
+
+    if (const auto state_log_path = m_nh_private.param<std::string>("state_log/path", ""); !state_log_path.empty()) {
+        m_state_log.open(state_log_path);
+    }
+    if (const auto pose_channel_name = m_nh_private.param<std::string>("pose_channel/name", ""); !pose_channel_name.empty()) {
+        m_pose_channel.open(pose_channel_name);
+    }
+
+    m_queue.reserve(m_queue_capacity);
+
+    if (const double cpu_budget = m_nh_private.param<double>("governor/cpu_budget", 0.0); cpu_budget > 0.0)
+    {
+        m_governor.emplace(cpu_budget, m_nh_private.param<double>("governor/window", 1.0));
+        m_degradation_pub = m_nh_private.advertise<std_msgs::UInt8>("degradation_level", 1, true);
+        publish_degradation_level();
+    }
+
+    if (m_nh_private.param<bool>("shadow/enabled", false)) {
+        start_shadow();
+    }
+
+    m_tf_msg.transforms.resize(1);
+    m_tf_msg.transforms.front().header.frame_id = m_map_frame;
+    m_tf_msg.transforms.front().child_frame_id = m_base_frame;
     m_pose_msg.header.frame_id = m_map_frame;
     m_vel_msg.header.frame_id = m_base_frame;
 
     // TODO: Measure accelerometer bias.
+}
 
-    utility::wait_for_message<sensor_msgs::Imu>(m_imu_sub);
+KalmanNode::~KalmanNode()
+{
+    // Whatever led up to a shutdown is worth keeping, also right after an anomaly was dumped.
+    m_flight_recorder.wait();
+    m_flight_recorder.dump("shutdown");
 }
 
 void KalmanNode::start()
 {
-    m_previous_imu_time = ros::Time::now();
+    begin(ros::Time::now());
     m_timer.start();
     ROS_INFO("Timer started!");
 }
 
+void KalmanNode::run_realtime(ros::CallbackQueue& queue)
+{
+    const int priority = m_nh_private.param<int>("realtime/priority", 80);
+    const auto cpus = m_nh_private.param<std::vector<int>>("realtime/cpus", {});
+    const double report_period = m_nh_private.param<double>("realtime/report_period", 10.0);
+
+    // Everything the processing path needs is allocated by now, so lock it in memory.
+    if (m_nh_private.param<bool>("realtime/lock_memory", true)) {
+        realtime::lock_memory();
+    }
+    if (!cpus.empty()) {
+        realtime::set_cpu_affinity(cpus);
+    }
+    realtime::set_fifo_priority(priority);
+
+    realtime::DeadlineScheduler scheduler{m_period};
+    const auto report_cycles = static_cast<std::uint64_t>(std::max(1.0, report_period / m_period));
+
+    begin(ros::Time::now());
+    scheduler.start();
+    ROS_INFO("Real-time loop started at priority [%d].", priority);
+
+    while (ros::ok())
+    {
+        // Serve subscriber callbacks right up to the deadline, then sleep precisely until it.
+        while (scheduler.remaining() > kCallbackSlack) {
+            queue.callAvailable(ros::WallDuration{scheduler.remaining() - kCallbackSlack});
+        }
+        const double lateness = scheduler.wait();
+
+        step(ros::Time::now());
+
+        if (const auto missed = scheduler.complete(); missed > 0) {
+            ROS_WARN_THROTTLE(1.0, "Filter step missed %lu deadlines (woke %f s late).", static_cast<unsigned long>(missed), lateness);
+        }
+
+        if (const auto& statistics = scheduler.statistics(); statistics.cycles >= report_cycles)
+        {
+            ROS_INFO("Real-time loop: %lu cycles, %lu missed deadlines, max lateness [%f], max cycle [%f].",
+                     static_cast<unsigned long>(statistics.cycles), static_cast<unsigned long>(statistics.missed),
+                     statistics.max_lateness, statistics.max_duration);
+            scheduler.reset_statistics();
+        }
+    }
+}
+
+void KalmanNode::begin(const ros::Time& now)
+{
+    const ros::Duration startup_timeout{m_nh_private.param<double>("startup/timeout", 10.0)};
+    m_readiness.start(now, startup_timeout);
+
+    m_previous_imu_time = now;
+    m_previous_predict_time = m_previous_imu_time;
+}
+
 void KalmanNode::initialise_kalman_filter()
 {
     const double x0     = m_nh_private.param<double>("initial/x", 0.0);
@@ -75,132 +211,832 @@ void KalmanNode::initialise_kalman_filter()
     const ugl::Vector<2> vel0 = ugl::Vector<2>::Zero();
 
     m_kalman_filter = KalmanFilter(theta0, pos0, vel0);
+
+    // Resume from the checkpoint left by a previous run, if it is recent enough.
+    const auto checkpoint_path = m_nh_private.param<std::string>("checkpoint/path", "");
+    const double checkpoint_max_age = m_nh_private.param<double>("checkpoint/max_age", 5.0);
+    if (checkpoint_path.empty() || !m_checkpoint.open(checkpoint_path)) {
+        return;
+    }
+
+    if (const auto checkpoint = m_checkpoint.load())
+    {
+        const ros::Duration age = ros::Time::now() - checkpoint->stamp;
+        if (age >= ros::Duration{0.0} && age.toSec() <= checkpoint_max_age)
+        {
+            m_kalman_filter = checkpoint->filter;
+            ROS_INFO("Resumed filter state from checkpoint [%s] of age [%f].", checkpoint_path.c_str(), age.toSec());
+        }
+        else
+        {
+            ROS_INFO("Checkpoint [%s] of age [%f] is too old. Using initial state.", checkpoint_path.c_str(), age.toSec());
+        }
+    }
+}
+
+void KalmanNode::load_overload_policy()
+{
+    const auto imu_policy = m_nh_private.param<std::string>("queue/overload_imu", "coalesce");
+    m_overload_imu_decimation = std::max(1, m_nh_private.param<int>("queue/imu_decimation", 2));
+    m_overload_drop_oldest_sonar = m_nh_private.param<bool>("queue/drop_oldest_sonar", true);
+
+    if (imu_policy == "coalesce") {
+        m_overload_imu_policy = ImuOverloadPolicy::Coalesce;
+    }
+    else if (imu_policy == "decimate") {
+        m_overload_imu_policy = ImuOverloadPolicy::Decimate;
+    }
+    else if (imu_policy == "none") {
+        m_overload_imu_policy = ImuOverloadPolicy::None;
+    }
+    else {
+        ROS_ERROR("Unknown imu overload policy [%s]. Expected 'coalesce', 'decimate' or 'none'.", imu_policy.c_str());
+    }
+}
+
+void KalmanNode::start_shadow()
+{
+    ShadowFilter::Config config;
+    config.process_noise.imu = m_nh_private.param<double>("shadow/imu_noise", config.process_noise.imu);
+    config.process_noise.command = m_nh_private.param<double>("shadow/command_noise", config.process_noise.command);
+    config.sonar_variance_scale = m_nh_private.param<double>("shadow/sonar_variance_scale", config.sonar_variance_scale);
+    const int capacity = m_nh_private.param<int>("shadow/capacity", 4096);
+    const double report_period = m_nh_private.param<double>("shadow/report_period", 1.0);
+
+    m_shadow_pose_pub = m_nh_private.advertise<geometry_msgs::PoseStamped>("shadow/pose_filtered", 10);
+    m_shadow_divergence_pub = m_nh_private.advertise<pet_mk_iv_msgs::FilterDivergence>("shadow/divergence", 10);
+
+    m_shadow.emplace(m_kalman_filter, config, static_cast<std::size_t>(std::max(2, capacity)), m_period);
+
+    ros::NodeHandle nh{m_nh_private};
+    nh.setCallbackQueue(&m_shadow_queue);
+    m_shadow_report_timer = nh.createWallTimer(ros::WallDuration{report_period}, &KalmanNode::shadow_report_cb, this);
+    m_shadow_spinner.emplace(1, &m_shadow_queue);
+    m_shadow_spinner->start();
+    ROS_INFO("Shadow filter started with imu noise [%f], command noise [%f] and sonar variance scale [%f].",
+             config.process_noise.imu, config.process_noise.command, config.sonar_variance_scale);
+}
+
+const CpuGovernor::Level& KalmanNode::degradation() const
+{
+    return m_governor ? m_governor->settings() : CpuGovernor::kLevels.front();
+}
+
+void KalmanNode::load_range_sensors()
+{
+    // Each sensor is configured under range_sensors/<name>/. Defaults to the single middle sonar on the Uno.
+    const auto names = m_nh_private.param<std::vector<std::string>>("range_sensors/names", {"mid"});
+
+    std::vector<std::string> subscribed_topics;
+    std::vector<int> topic_indices;
+    for (const auto& name : names)
+    {
+        if (m_range_sensors.size() == kMaxRangeSensors)
+        {
+            ROS_ERROR("At most %d range sensors can be fused. Ignoring range sensor [%s].", kMaxRangeSensors, name.c_str());
+            continue;
+        }
+
+        const std::string prefix = "range_sensors/" + name + "/";
+        const auto topic = m_nh_private.param<std::string>(prefix + "topic", "dist_sensors");
+        const auto type  = m_nh_private.param<std::string>(prefix + "type", "distance");
+
+        if (type != "distance" && type != "range")
+        {
+            ROS_ERROR("Unknown message type [%s] for range sensor [%s]. Expected 'distance' or 'range'.", type.c_str(), name.c_str());
+            continue;
+        }
+
+        RangeSensor sensor;
+        sensor.frame_id  = m_nh_private.param<std::string>(prefix + "frame_id", "dist_sensor_" + name);
+        sensor.position  = ugl::Vector<2>{m_nh_private.param<double>(prefix + "x", 0.0),
+                                          m_nh_private.param<double>(prefix + "y", 0.0)};
+        sensor.direction = m_nh_private.param<double>(prefix + "yaw", 0.0);
+        sensor.from_tf   = !m_nh_private.hasParam(prefix + "x");
+        sensor.clock_sync = m_nh_private.param<bool>(prefix + "clock_sync", true);
+        sensor.range_rate = RangeRateEstimator{m_nh_private.param<int>(prefix + "velocity_window", 5)};
+        m_range_sensors.push_back(sensor);
+
+        // Several sensors may share one topic, e.g. the Uno publishes all its sonars on 'dist_sensors'.
+        const auto subscribed = std::find(subscribed_topics.begin(), subscribed_topics.end(), topic);
+        if (subscribed != subscribed_topics.end())
+        {
+            m_range_sensors.back().topic_index = topic_indices[subscribed - subscribed_topics.begin()];
+            continue;
+        }
+
+        if (type == "distance") {
+            m_range_subs.push_back(m_nh.subscribe(topic, 10, &KalmanNode::sonar_cb, this));
+        }
+        else {
+            m_range_subs.push_back(m_nh.subscribe(topic, 10, &KalmanNode::range_cb, this));
+        }
+
+        subscribed_topics.push_back(topic);
+        topic_indices.push_back(m_readiness.add(m_range_subs.back().getTopic()));
+        m_range_sensors.back().topic_index = topic_indices.back();
+    }
+}
+
+void KalmanNode::subscribe_command()
+{
+    // Commands are an optional, cheap prediction source for when imu data is sparse.
+    const auto source = m_nh_private.param<std::string>("command/source", "none");
+    m_command_imu_timeout = ros::Duration{m_nh_private.param<double>("command/imu_timeout", kImuMaxDuration.toSec())};
+
+    if (source == "engine_command") {
+        m_command_sub = m_nh.subscribe("engine_command", 10, &KalmanNode::engine_command_cb, this);
+    }
+    else if (source == "cmd_vel") {
+        m_command_sub = m_nh.subscribe("cmd_vel", 10, &KalmanNode::cmd_vel_cb, this);
+    }
+    else if (source != "none") {
+        ROS_ERROR("Unknown command source [%s]. Expected 'none', 'engine_command' or 'cmd_vel'.", source.c_str());
+    }
+}
+
+int KalmanNode::find_range_sensor(const std::string& frame_id) const
+{
+    for (int i = 0; i < static_cast<int>(m_range_sensors.size()); ++i)
+    {
+        if (m_range_sensors[i].frame_id == frame_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+ros::Time KalmanNode::correct_range_stamp(RangeSensor& sensor, const ros::Time& stamp)
+{
+    return sensor.clock_sync ? sensor.clock.correct(stamp, ros::Time::now()) : stamp;
+}
+
+bool KalmanNode::resolve_extrinsics()
+{
+    bool all_resolved = lookup_extrinsics(m_imu_frame, m_imu_extrinsics);
+
+    for (auto& sensor : m_range_sensors)
+    {
+        if (!sensor.from_tf) {
+            continue;
+        }
+        SensorExtrinsics extrinsics;
+        if (!lookup_extrinsics(sensor.frame_id, extrinsics))
+        {
+            all_resolved = false;
+            continue;
+        }
+        sensor.position  = extrinsics.lever_arm.head<2>();
+        sensor.direction = std::atan2(extrinsics.rotation(1, 0), extrinsics.rotation(0, 0));
+    }
+
+    return all_resolved;
+}
+
+bool KalmanNode::lookup_extrinsics(const std::string& frame, SensorExtrinsics& extrinsics) const
+{
+    try
+    {
+        const auto transform = m_tf_buffer.lookupTransform(m_base_frame, frame, ros::Time{0});
+        extrinsics = SensorExtrinsics{transform.transform};
+        return true;
+    }
+    catch (const tf2::TransformException& ex)
+    {
+        ROS_WARN("Could not resolve extrinsics of sensor frame [%s]: %s", frame.c_str(), ex.what());
+        return false;
+    }
 }
 
 ros::Duration KalmanNode::get_queue_latency(const ros::Time& now) const
 {
-    return m_queue.empty() ? ros::Duration{0.0} : (now - m_queue.top()->stamp());
+    return m_queue.empty() ? ros::Duration{0.0} : (now - stamp_of(m_queue.top()));
+}
+
+void KalmanNode::enqueue(const QueuedMeasurement& measurement)
+{
+    if (m_queue.size() >= m_queue_capacity)
+    {
+        // Old sonar data is the cheapest to lose, a later sample measures the same velocity.
+        if (m_overload_drop_oldest_sonar && m_queue.remove_oldest<SonarMeasurement>()) {
+            ++m_load_shedding.sonar_dropped;
+        }
+        else
+        {
+            const QueuedMeasurement& oldest = m_queue.top();
+            if (std::holds_alternative<ImuMeasurement>(oldest)) {
+                ++m_load_shedding.imu_dropped;
+            }
+            else if (std::holds_alternative<SonarMeasurement>(oldest)) {
+                ++m_load_shedding.sonar_dropped;
+            }
+            else {
+                ++m_load_shedding.command_dropped;
+            }
+            m_queue.pop();
+        }
+        ROS_WARN_THROTTLE(1.0, "Measurement queue is full [%zu]. Dropping old measurements.", m_queue_capacity);
+    }
+    m_queue.push(measurement);
+}
+
+void KalmanNode::update_overload(const ros::Time& now, const ros::Duration& latency)
+{
+    if (!m_overloaded && latency > m_queue_max_latency)
+    {
+        m_overloaded = true;
+        m_overload_start = now;
+        m_load_shedding = LoadShedding{};
+        ROS_WARN("Processing is falling behind. Shedding load until back in real time.");
+    }
+    // Some margin, so that a latency hovering around the limit does not toggle shedding every call.
+    else if (m_overloaded && latency * 2.0 < m_queue_max_latency)
+    {
+        m_overloaded = false;
+        ROS_INFO("Back in real time after [%f] s. Dropped %lu imu, %lu sonar and %lu command measurements, "
+                 "decimated %lu and coalesced %lu imu measurements.",
+                 (now - m_overload_start).toSec(),
+                 static_cast<unsigned long>(m_load_shedding.imu_dropped),
+                 static_cast<unsigned long>(m_load_shedding.sonar_dropped),
+                 static_cast<unsigned long>(m_load_shedding.command_dropped),
+                 static_cast<unsigned long>(m_load_shedding.imu_decimated),
+                 static_cast<unsigned long>(m_load_shedding.imu_coalesced));
+        m_load_shedding = LoadShedding{};
+    }
 }
 
 void KalmanNode::timer_cb(const ros::TimerEvent& e)
 {
-    if (auto current_latency = get_queue_latency(e.current_real); current_latency > kQueueMaxLatency)
+    step(e.current_real);
+}
+
+void KalmanNode::step(const ros::Time& now)
+{
+    const auto processing_start = std::chrono::steady_clock::now();
+    const double step_cpu_start = m_governor ? CpuGovernor::thread_cpu_time() : 0.0;
+    PET_TRACE(timer_begin, now.toNSec(), m_queue.size());
+
+    if (!m_started)
+    {
+        if (!m_readiness.check(now)) {
+            return;
+        }
+        // Measurements which waited longer than queue/max_latency are dropped rather than counted
+        // as a processing overload. Integration starts from the oldest one left.
+        std::size_t stale = 0;
+        for (const ros::Time oldest = now - m_queue_max_latency; !m_queue.empty() && stamp_of(m_queue.top()) < oldest; ++stale) {
+            m_queue.pop();
+        }
+        if (stale > 0) {
+            ROS_INFO("Dropped %zu measurements received more than [%f] s before starting.", stale, m_queue_max_latency.toSec());
+        }
+        m_previous_imu_time = m_queue.empty() ? now : stamp_of(m_queue.top());
+        m_previous_predict_time = m_previous_imu_time;
+        m_started = true;
+    }
+
+    // Extrinsics are static, so they are only looked up again when static transforms change.
+    // Frames missing from TF keep their parameter or identity extrinsics until then.
+    if (m_extrinsics_dirty)
+    {
+        resolve_extrinsics();
+        m_extrinsics_dirty = false;
+    }
+
+    const ros::Duration current_latency = get_queue_latency(now);
+    if (current_latency > m_queue_max_latency)
     {
         ROS_WARN("Actual processing latency [%f] exceeds maximum desired latency [%f]. Filter might not be running in real-time.",
-                 current_latency.toSec(), kQueueMaxLatency.toSec());
+                 current_latency.toSec(), m_queue_max_latency.toSec());
+        dump_flight_recorder(now, "latency");
+    }
+    update_overload(now, current_latency);
+
+    const ros::Time horizon = now - m_queue_min_latency;
+
+    // Imu decimation asked for by the CPU governor, or by the overload policy while behind.
+    int imu_decimation = degradation().imu_decimation;
+    if (m_overloaded && m_overload_imu_policy == ImuOverloadPolicy::Decimate) {
+        imu_decimation = std::max(imu_decimation, m_overload_imu_decimation);
     }
 
-    while (get_queue_latency(e.current_real) > kQueueMinLatency)
+    while (!m_queue.empty() && stamp_of(m_queue.top()) < horizon)
     {
-        auto measurement_ptr = m_queue.top();
+        const QueuedMeasurement measurement = m_queue.top();
         m_queue.pop();
+        PET_TRACE(drain_begin, stamp_of(measurement).toNSec(), now.toNSec(), m_queue.size());
 
-        if (auto imu_measurement_ptr = std::dynamic_pointer_cast<const ImuMeasurement>(measurement_ptr)) {
-            process_imu_measurement(*imu_measurement_ptr);
+        if (const auto* imu_measurement = std::get_if<ImuMeasurement>(&measurement))
+        {
+            if (m_overloaded && m_overload_imu_policy == ImuOverloadPolicy::Coalesce) {
+                coalesce_imu_measurements(*imu_measurement, horizon);
+            }
+            else if (++m_imu_count % static_cast<std::uint64_t>(imu_decimation) == 0) {
+                process_imu_measurement(*imu_measurement);
+            }
+            else if (m_overloaded) {
+                ++m_load_shedding.imu_decimated;
+            }
+            PET_TRACE(drain_end, static_cast<int>(trace::kImu));
         }
-        else if (auto sonar_measurement_ptr = std::dynamic_pointer_cast<const SonarMeasurement>(measurement_ptr)) {
-            process_sonar_measurement(*sonar_measurement_ptr);
+        else if (const auto* sonar_measurement = std::get_if<SonarMeasurement>(&measurement))
+        {
+            process_sonar_measurement(*sonar_measurement);
+            PET_TRACE(drain_end, static_cast<int>(trace::kSonar));
         }
-        else {
-            ROS_ERROR("Measurement pointer could not be downcasted to any known measurement type. This is a programming logic error.");
+        else if (const auto* command_measurement = std::get_if<CommandMeasurement>(&measurement))
+        {
+            process_command_measurement(*command_measurement);
+            PET_TRACE(drain_end, static_cast<int>(trace::kCommand));
+        }
+    }
+
+    // Velocities from all sonars which reported during this call are fused in one update together with
+    // the pseudo-measurements. Since pseudo-measurements are not dependent on received data we simply
+    // update them once per timer call.
+    if (m_idle)
+    {
+        // Sonar velocities of a parked robot are nothing but noise.
+        for (auto& sensor : m_range_sensors) {
+            sensor.has_velocity = false;
         }
     }
+    else
+    {
+        // Sonar velocities not yet fused are kept, a skipped update uses the latest of each sonar.
+        if (m_update_cycles++ % static_cast<std::uint64_t>(degradation().update_divisor) == 0)
+        {
+            velocity_update();
+            if (m_kalman_filter.innovation_nis() > m_flight_recorder_max_nis) {
+                dump_flight_recorder(now, "innovation");
+            }
+        }
+
+        // Bridge any gap in imu data up to the processed horizon with the latest command.
+        command_predict(horizon);
+    }
+
+    if (m_shadow) {
+        m_shadow->compare(now, m_kalman_filter);
+    }
+
+    m_checkpoint.save(now, m_kalman_filter);
+
+    // Shared memory is written every step, reduced publish rates only concern ROS transport.
+    if (m_pose_channel.is_open())
+    {
+        const auto& vel = m_kalman_filter.velocity();
+        const auto& pos = m_kalman_filter.position();
+        m_pose_channel.write(PoseSample{static_cast<std::int64_t>(now.toNSec()), m_kalman_filter.heading(), vel.x(), vel.y(), pos.x(), pos.y()});
+    }
+
+    // The state of a parked robot does not change, so it is published at a reduced rate.
+    const int publish_divisor = m_idle ? m_idle_publish_divisor : degradation().publish_divisor;
+    if (m_publish_cycles++ % static_cast<std::uint64_t>(publish_divisor) == 0)
+    {
+        publish_tf(now);
+        publish_pose(now);
+        publish_velocity(now);
+    }
 
-    // Since pseudo-measurements are not dependent on received data we simply update them once per timer call.
-    m_kalman_filter.pseudo_lateral_velocity_update(0.0);
+    const std::chrono::duration<double> processing_time = std::chrono::steady_clock::now() - processing_start;
+    record_state(now, current_latency, processing_time.count());
 
-    publish_tf(e.current_real);
-    publish_pose(e.current_real);
-    publish_velocity(e.current_real);
+    if (m_governor && m_governor->update(CpuGovernor::thread_cpu_time() - step_cpu_start))
+    {
+        ROS_INFO("CPU share [%f]. Degradation level changed to %d.", m_governor->share(), m_governor->level());
+        publish_degradation_level();
+    }
+
+    PET_TRACE(timer_end, now.toNSec(), m_queue.size());
 }
 
 void KalmanNode::process_imu_measurement(const ImuMeasurement& measurement)
 {
-    const ros::Duration dt = measurement.stamp() - m_previous_imu_time;
+    // Time since the previous prediction, which may have been done from commands.
+    const ros::Duration dt = measurement.stamp() - m_previous_predict_time;
     if (dt > kImuMaxDuration) {
         ROS_WARN("Time between IMU messages is high [dt=%f]. Might result in large discretisation errors.", dt.toSec());
     }
-    m_kalman_filter.predict(dt.toSec(), measurement.acceleration(), measurement.angular_rate());
+
+    if (m_stationary_enabled)
+    {
+        m_stationary_detector.add(measurement.acceleration(), measurement.angular_rate());
+        update_idle();
+    }
+
+    // Otherwise this interval has already been predicted from commands. While idle the interval
+    // is skipped, the zero velocity update holds the state.
+    if (dt > ros::Duration{0.0})
+    {
+        if (!m_idle)
+        {
+            m_kalman_filter.predict(dt.toSec(), measurement.acceleration(), measurement.angular_rate());
+            if (m_shadow) {
+                m_shadow->predict(dt.toSec(), measurement.acceleration(), measurement.angular_rate());
+            }
+        }
+        m_previous_predict_time = measurement.stamp();
+    }
     m_previous_imu_time = measurement.stamp();
+    m_previous_angular_rate = measurement.angular_rate().z();
+}
+
+void KalmanNode::coalesce_imu_measurements(const ImuMeasurement& first, const ros::Time& horizon)
+{
+    // Consecutive samples up to the processed horizon are integrated as one step with their mean
+    // acceleration and rate, but never over more than kImuMaxDuration.
+    ugl::Vector3 acc = first.acceleration();
+    ugl::Vector3 rate = first.angular_rate();
+    ros::Time stamp = first.stamp();
+    int count = 1;
+
+    while (!m_queue.empty() && stamp_of(m_queue.top()) < horizon)
+    {
+        const auto* next = std::get_if<ImuMeasurement>(&m_queue.top());
+        if (next == nullptr || next->stamp() - m_previous_predict_time > kImuMaxDuration) {
+            break;
+        }
+        acc += next->acceleration();
+        rate += next->angular_rate();
+        stamp = next->stamp();
+        ++count;
+        m_queue.pop();
+    }
+
+    m_load_shedding.imu_coalesced += static_cast<std::uint64_t>(count - 1);
+    process_imu_measurement(ImuMeasurement{stamp, acc / count, rate / count});
+}
+
+void KalmanNode::process_command_measurement(const CommandMeasurement& measurement)
+{
+    // The previous command was in effect up until this one.
+    command_predict(measurement.stamp());
+
+    m_command_linear_vel = measurement.linear_velocity();
+    m_command_angular_vel = measurement.angular_velocity();
+    m_has_command = true;
+
+    // A command to move ends idling right away, without waiting for the imu window.
+    if (m_stationary_enabled) {
+        update_idle();
+    }
+}
+
+void KalmanNode::update_idle()
+{
+    // The imu alone cannot tell standstill from driving straight at constant speed, the command can.
+    const bool commanded_stop = m_has_command && m_command_linear_vel == 0.0 && m_command_angular_vel == 0.0;
+    const bool idle = m_stationary_detector.is_stationary() && (commanded_stop || (!m_has_command && !m_stationary_require_command));
+    if (idle == m_idle) {
+        return;
+    }
+
+    m_idle = idle;
+    if (m_idle)
+    {
+        m_kalman_filter.zero_velocity_update();
+        if (m_shadow) {
+            m_shadow->zero_velocity_update();
+        }
+        m_publish_cycles = 0;
+        ROS_INFO("Robot is stationary. Filter idles until it moves.");
+    }
+    else
+    {
+        ROS_INFO("Robot is moving. Filter resumes.");
+    }
+}
+
+void KalmanNode::command_predict(const ros::Time& until)
+{
+    // Commands only take over prediction while the imu is silent.
+    if (!m_has_command || until - m_previous_imu_time <= m_command_imu_timeout) {
+        return;
+    }
+
+    const ros::Duration dt = until - m_previous_predict_time;
+    if (dt > ros::Duration{0.0})
+    {
+        m_kalman_filter.command_predict(dt.toSec(), m_command_linear_vel, m_command_angular_vel);
+        if (m_shadow) {
+            m_shadow->command_predict(dt.toSec(), m_command_linear_vel, m_command_angular_vel);
+        }
+        m_previous_predict_time = until;
+    }
 }
 
 void KalmanNode::process_sonar_measurement(const SonarMeasurement& measurement)
 {
-    const ros::Duration dt = measurement.stamp() - m_previous_sonar_time;
-    if (dt > kSonarMaxDuration) {
-        ROS_WARN("Time between front sonar messages is too high [dt=%f]. Ignoring latest measurement.", dt.toSec());
+    RangeSensor& sensor = m_range_sensors[measurement.sensor_index()];
+
+    // Samples before a gap do not belong to the same line. The first sample has nothing before it.
+    const ros::Duration dt = measurement.stamp() - sensor.previous_stamp;
+    if (!sensor.previous_stamp.isZero() && dt > kSonarMaxDuration)
+    {
+        ROS_WARN("Time between sonar [%s] messages is too high [dt=%f]. Restarting its range rate window.", sensor.frame_id.c_str(), dt.toSec());
+        sensor.range_rate.reset();
     }
-    else {
-        const double velocity = (m_previous_sonar_distance - measurement.distance()) / dt.toSec();
-        m_kalman_filter.sonar_velocity_update(velocity);
+    sensor.range_rate.add(measurement.stamp(), measurement.distance());
+
+    if (sensor.range_rate.has_estimate())
+    {
+        // The range rate is the velocity of the sonar along its axis. Remove the part caused by
+        // the body rotating around the sonar's lever arm to get the body velocity along that axis.
+        const double range_rate = -sensor.range_rate.rate();
+        const ugl::Vector<2> axis{std::cos(sensor.direction), std::sin(sensor.direction)};
+        const ugl::Vector<2> lever_velocity = m_previous_angular_rate * ugl::Vector<2>{-sensor.position.y(), sensor.position.x()};
+
+        sensor.velocity = range_rate - axis.dot(lever_velocity);
+        sensor.variance = sensor.range_rate.variance();
+        sensor.has_velocity = true;
     }
-    m_previous_sonar_time = measurement.stamp();
-    m_previous_sonar_distance = measurement.distance();
+    sensor.previous_stamp = measurement.stamp();
 }
 
-void KalmanNode::imu_cb(const sensor_msgs::Imu& msg)
+void KalmanNode::velocity_update()
 {
-    m_queue.push(std::make_shared<ImuMeasurement>(msg));
+    static_assert(kMaxRangeSensors == 3, "Dispatch below must cover every possible number of range sensors.");
+
+    ugl::Vector<kMaxRangeSensors> velocities;
+    ugl::Vector<kMaxRangeSensors> directions;
+    ugl::Vector<kMaxRangeSensors> variances;
+    int count = 0;
+    for (auto& sensor : m_range_sensors)
+    {
+        if (sensor.has_velocity)
+        {
+            velocities[count] = sensor.velocity;
+            directions[count] = sensor.direction;
+            variances[count] = sensor.variance;
+            sensor.has_velocity = false;
+            ++count;
+        }
+    }
+
+    const auto lateral = KalmanFilter::pseudo_lateral_velocity_observation(0.0);
+
+    switch (count)
+    {
+    case 1:
+        m_kalman_filter.update(KalmanFilter::sonar_velocity_observation<1>(velocities.head<1>(), directions.head<1>(), variances.head<1>()), lateral);
+        break;
+    case 2:
+        m_kalman_filter.update(KalmanFilter::sonar_velocity_observation<2>(velocities.head<2>(), directions.head<2>(), variances.head<2>()), lateral);
+        break;
+    case 3:
+        m_kalman_filter.update(KalmanFilter::sonar_velocity_observation<3>(velocities, directions, variances), lateral);
+        break;
+    default:
+        m_kalman_filter.update(lateral);
+        break;
+    }
+
+    if (m_shadow) {
+        m_shadow->sonar_velocity_update(count, velocities, directions, variances);
+    }
+}
+
+void KalmanNode::record_state(const ros::Time& stamp, const ros::Duration& latency, double processing_time)
+{
+    const auto& vel = m_kalman_filter.velocity();
+    const auto& pos = m_kalman_filter.position();
+
+    FlightRecorder::Record record{FlightRecorder::Record::Kind::State, 0, static_cast<std::uint16_t>(m_queue.size()), stamp, {}};
+    record.values[0] = m_kalman_filter.heading();
+    record.values[1] = vel.x();
+    record.values[2] = vel.y();
+    record.values[3] = pos.x();
+    record.values[4] = pos.y();
+    record.values[5] = m_kalman_filter.innovation_nis();
+    record.values[6] = processing_time;
+    record.values[7] = latency.toSec();
+    m_flight_recorder.record(record);
+
+    if (m_state_log.is_open())
+    {
+        StateLogRecord log_record{};
+        log_record.stamp = static_cast<std::int64_t>(stamp.toNSec());
+        log_record.state[0] = m_kalman_filter.heading();
+        Eigen::Map<ugl::Vector<2>>(log_record.state + 1) = vel;
+        Eigen::Map<ugl::Vector<2>>(log_record.state + 3) = pos;
+        Eigen::Map<ugl::Vector<5>>(log_record.covariance_diagonal) = m_kalman_filter.covariance().diagonal();
+        Eigen::Map<ugl::Vector<4>>(log_record.innovation) = m_kalman_filter.innovation();
+        log_record.innovation_size = static_cast<std::uint8_t>(m_kalman_filter.innovation_size());
+        log_record.innovation_nis = m_kalman_filter.innovation_nis();
+        log_record.processing_time = processing_time;
+        log_record.queue_latency = latency.toSec();
+        log_record.queue_depth = record.queue_depth;
+        m_state_log.append(log_record);
+    }
+}
+
+void KalmanNode::record_measurement(const SonarMeasurement& measurement)
+{
+    FlightRecorder::Record record{FlightRecorder::Record::Kind::Sonar, static_cast<std::uint8_t>(measurement.sensor_index()),
+                                  static_cast<std::uint16_t>(m_queue.size()), measurement.stamp(), {}};
+    record.values[0] = measurement.distance();
+    m_flight_recorder.record(record);
+}
+
+void KalmanNode::record_measurement(const CommandMeasurement& measurement)
+{
+    FlightRecorder::Record record{FlightRecorder::Record::Kind::Command, 0, static_cast<std::uint16_t>(m_queue.size()), measurement.stamp(), {}};
+    record.values[0] = measurement.linear_velocity();
+    record.values[1] = measurement.angular_velocity();
+    m_flight_recorder.record(record);
+}
+
+void KalmanNode::dump_flight_recorder(const ros::Time& now, const std::string& reason)
+{
+    // A persisting anomaly would otherwise trigger a dump every timer call.
+    if (!m_flight_recorder_previous_dump.isZero() && now - m_flight_recorder_previous_dump < m_flight_recorder_cooldown) {
+        return;
+    }
+    if (m_flight_recorder.dump(reason)) {
+        m_flight_recorder_previous_dump = now;
+    }
+}
+
+void KalmanNode::imu_cb(const ImuSample& msg)
+{
+    const CpuGovernor::Scope cpu_scope{m_governor};
+    const ros::Time now = ros::Time::now();
+    PET_TRACE(imu_received, msg.stamp.toNSec(), now.toNSec(), m_queue.size());
+    m_readiness.notify(m_imu_topic_index, now);
+
+    FlightRecorder::Record record{FlightRecorder::Record::Kind::Imu, 0, static_cast<std::uint16_t>(m_queue.size()), msg.stamp, {}};
+    Eigen::Map<ugl::Vector3>(record.values) = msg.linear_acceleration;
+    Eigen::Map<ugl::Vector3>(record.values + 3) = msg.angular_velocity;
+    m_flight_recorder.record(record);
+
+    enqueue(ImuMeasurement{msg, m_imu_extrinsics});
 }
 
 void KalmanNode::sonar_cb(const pet_mk_iv_msgs::DistanceMeasurement& msg)
 {
-    if (msg.header.frame_id == "dist_sensor_mid")
+    const CpuGovernor::Scope cpu_scope{m_governor};
+    const int index = find_range_sensor(msg.header.frame_id);
+    if (index < 0) {
+        return;
+    }
+    const ros::Time now = ros::Time::now();
+    PET_TRACE(sonar_received, index, msg.header.stamp.toNSec(), now.toNSec(), m_queue.size());
+    m_readiness.notify(m_range_sensors[index].topic_index, now);
+
+    // A distance of zero is reported when no echo was received.
+    if (msg.distance > 0)
     {
-        m_queue.push(std::make_shared<SonarMeasurement>(msg));
+        const ros::Time stamp = correct_range_stamp(m_range_sensors[index], msg.header.stamp);
+        const SonarMeasurement measurement{msg, index, stamp};
+        record_measurement(measurement);
+        enqueue(measurement);
     }
 }
 
+void KalmanNode::range_cb(const sensor_msgs::Range& msg)
+{
+    const CpuGovernor::Scope cpu_scope{m_governor};
+    const int index = find_range_sensor(msg.header.frame_id);
+    if (index < 0) {
+        return;
+    }
+    const ros::Time now = ros::Time::now();
+    PET_TRACE(sonar_received, index, msg.header.stamp.toNSec(), now.toNSec(), m_queue.size());
+    m_readiness.notify(m_range_sensors[index].topic_index, now);
+
+    // Values outside [min_range, max_range] are no-detections and should be discarded.
+    if (msg.range >= msg.min_range && msg.range <= msg.max_range)
+    {
+        const ros::Time stamp = correct_range_stamp(m_range_sensors[index], msg.header.stamp);
+        const SonarMeasurement measurement{msg, index, stamp};
+        record_measurement(measurement);
+        enqueue(measurement);
+    }
+}
+
+void KalmanNode::engine_command_cb(const pet_mk_iv_msgs::EngineCommand& msg)
+{
+    const CpuGovernor::Scope cpu_scope{m_governor};
+    const CommandMeasurement measurement{msg};
+    PET_TRACE(command_received, measurement.stamp().toNSec(), ros::Time::now().toNSec(), m_queue.size());
+    record_measurement(measurement);
+    enqueue(measurement);
+}
+
+void KalmanNode::cmd_vel_cb(const geometry_msgs::TwistStamped& msg)
+{
+    const CpuGovernor::Scope cpu_scope{m_governor};
+    const CommandMeasurement measurement{msg};
+    PET_TRACE(command_received, measurement.stamp().toNSec(), ros::Time::now().toNSec(), m_queue.size());
+    record_measurement(measurement);
+    enqueue(measurement);
+}
+
+void KalmanNode::tf_static_cb(const tf2_msgs::TFMessage& msg)
+{
+    for (const auto& transform : msg.transforms) {
+        m_tf_buffer.setTransform(transform, "tf_static", true);
+    }
+    m_extrinsics_dirty = true;
+}
+
+bool KalmanNode::dump_flight_recorder_cb(std_srvs::Trigger::Request& /*req*/, std_srvs::Trigger::Response& res)
+{
+    res.success = m_flight_recorder.dump("service");
+    res.message = res.success ? "Flight recorder dump started." : "Flight recorder dump already in progress.";
+    return true;
+}
+
 void KalmanNode::publish_tf(const ros::Time& stamp)
 {
+    PET_TRACE(publish_begin, static_cast<int>(trace::kTf));
+
     const auto& pos = m_kalman_filter.position();
-    m_tf_msg.transform.translation.x = pos.x();
-    m_tf_msg.transform.translation.y = pos.y();
+    auto& transform = m_tf_msg.transforms.front();
+    transform.transform.translation.x = pos.x();
+    transform.transform.translation.y = pos.y();
 
     const double yaw = m_kalman_filter.heading();
     const ugl::Vector3 axis = ugl::Vector3::UnitZ();
-    m_tf_msg.transform.rotation = tf2::toMsg(ugl::math::to_quat(yaw, axis));
+    transform.transform.rotation = tf2::toMsg(ugl::math::to_quat(yaw, axis));
 
-    m_tf_msg.header.stamp = stamp;
-    m_tf_broadcaster.sendTransform(m_tf_msg);
+    transform.header.stamp = stamp;
+    m_tf_pub.publish(m_tf_msg);
+
+    PET_TRACE(publish_end, static_cast<int>(trace::kTf));
 }
 
 void KalmanNode::publish_pose(const ros::Time& stamp)
 {
+    PET_TRACE(publish_begin, static_cast<int>(trace::kPose));
+
     const auto& pos = m_kalman_filter.position();
     m_pose_msg.pose.position.x = pos.x();
     m_pose_msg.pose.position.y = pos.y();
 
     const double yaw = m_kalman_filter.heading();
     const ugl::Vector3 axis = ugl::Vector3::UnitZ();
-    m_tf_msg.transform.rotation = tf2::toMsg(ugl::math::to_quat(yaw, axis));
+    m_pose_msg.pose.orientation = tf2::toMsg(ugl::math::to_quat(yaw, axis));
 
     m_pose_msg.header.stamp = stamp;
     m_pose_pub.publish(m_pose_msg);
+
+    PET_TRACE(publish_end, static_cast<int>(trace::kPose));
 }
 
 void KalmanNode::publish_velocity(const ros::Time& stamp)
 {
+    PET_TRACE(publish_begin, static_cast<int>(trace::kVelocity));
+
     const auto& vel = m_kalman_filter.velocity();
     m_vel_msg.vector.x = vel.x();
     m_vel_msg.vector.y = vel.y();
 
     m_vel_msg.header.stamp = stamp;
     m_velocity_pub.publish(m_vel_msg);
+
+    PET_TRACE(publish_end, static_cast<int>(trace::kVelocity));
 }
 
-} // namespace pet
+void KalmanNode::publish_degradation_level()
+{
+    std_msgs::UInt8 msg;
+    msg.data = static_cast<std::uint8_t>(m_governor->level());
+    m_degradation_pub.publish(msg);
+}
+
+void KalmanNode::shadow_report_cb(const ros::WallTimerEvent&)
+{
+    ShadowFilter::Report report;
+    if (m_shadow->latest_report(report)) {
+        publish_shadow_report(report);
+    }
+}
 
-int main(int argc, char** argv)
+void KalmanNode::publish_shadow_report(const ShadowFilter::Report& report)
 {
-    ros::init(argc, argv, "kalman_node");
-    ros::NodeHandle nh("");
-    ros::NodeHandle nh_private("~");
+    // Called on the shadow spinner thread, so nothing here is shared with the processing path.
+    geometry_msgs::PoseStamped pose;
+    pose.header.stamp = report.stamp;
+    pose.header.frame_id = m_map_frame;
+    pose.pose.position.x = report.state[3];
+    pose.pose.position.y = report.state[4];
+    pose.pose.orientation = tf2::toMsg(ugl::math::to_quat(report.state[0], ugl::Vector3::UnitZ()));
+    m_shadow_pose_pub.publish(pose);
 
-    ROS_INFO("Initialising node...");
-    pet::KalmanNode node(nh, nh_private);
-    ROS_INFO("Node initialisation done.");
+    pet_mk_iv_msgs::FilterDivergence divergence;
+    divergence.header.stamp = report.stamp;
+    divergence.header.frame_id = m_map_frame;
+    divergence.position = report.position;
+    divergence.heading = report.heading;
+    divergence.velocity = report.velocity;
+    divergence.normalised = report.normalised;
+    divergence.max_position = report.max_position;
+    divergence.cpu_share = report.cpu_share;
+    divergence.dropped = report.dropped;
+    divergence.resyncs = report.resyncs;
+    m_shadow_divergence_pub.publish(divergence);
+}
 
-    node.start();
-    ros::spin();
-}
\ No newline at end of file
+} // namespace pet
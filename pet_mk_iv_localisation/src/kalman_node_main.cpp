@@ -0,0 +1,25 @@
+#include "kalman_node.h"
+
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+
+int main(int argc, char** argv)
+{
+    ros::init(argc, argv, "kalman_node");
+    ros::NodeHandle nh("");
+    ros::NodeHandle nh_private("~");
+
+    ROS_INFO("Initialising node...");
+    pet::KalmanNode node(nh, nh_private);
+    ROS_INFO("Node initialisation done.");
+
+    if (nh_private.param<bool>("realtime/enabled", false))
+    {
+        node.run_realtime(*ros::getGlobalCallbackQueue());
+    }
+    else
+    {
+        node.start();
+        ros::spin();
+    }
+}
@@ -0,0 +1,82 @@
+"""Reader of the latest pose that kalman_node publishes into shared memory.
+
+Reads are a copy of a few words from the segment set with the node's pose_channel/name
+parameter, with no ROS transport in between:
+
+    from pet_mk_iv_localisation.pose_channel import PoseChannel
+
+    channel = PoseChannel('/pet_pose')
+    sample = channel.read()
+    if sample is not None:
+        print(sample.position_x, sample.position_y, sample.heading)
+
+Needs libpose_channel_reader.so on the library path, which sourcing the workspace provides.
+"""
+
+import ctypes
+
+
+class PoseSample(ctypes.Structure):
+    """Filter state, laid out as pet::PoseSample. The stamp is in nanoseconds."""
+
+    _fields_ = [
+        ('stamp',      ctypes.c_int64),
+        ('heading',    ctypes.c_double),
+        ('velocity_x', ctypes.c_double),
+        ('velocity_y', ctypes.c_double),
+        ('position_x', ctypes.c_double),
+        ('position_y', ctypes.c_double),
+    ]
+
+
+def _load_library():
+    lib = ctypes.CDLL('libpose_channel_reader.so')
+
+    lib.pet_pose_channel_open.argtypes = [ctypes.c_char_p]
+    lib.pet_pose_channel_open.restype = ctypes.c_void_p
+    lib.pet_pose_channel_read.argtypes = [ctypes.c_void_p, ctypes.POINTER(PoseSample)]
+    lib.pet_pose_channel_read.restype = ctypes.c_int
+    lib.pet_pose_channel_count.argtypes = [ctypes.c_void_p]
+    lib.pet_pose_channel_count.restype = ctypes.c_uint64
+    lib.pet_pose_channel_close.argtypes = [ctypes.c_void_p]
+    lib.pet_pose_channel_close.restype = None
+
+    return lib
+
+
+class PoseChannel(object):
+
+    _lib = None
+
+    def __init__(self, name='/pet_pose'):
+        if PoseChannel._lib is None:
+            PoseChannel._lib = _load_library()
+
+        self._handle = self._lib.pet_pose_channel_open(name.encode('ascii'))
+        if not self._handle:
+            raise IOError('Could not open pose channel [%s]. Is kalman_node running with pose_channel/name set?' % name)
+
+    def read(self):
+        """Returns a copy of the latest sample, or None if nothing has been written yet."""
+        sample = PoseSample()
+        if not self._lib.pet_pose_channel_read(self._handle, ctypes.byref(sample)):
+            return None
+        return sample
+
+    def count(self):
+        """Number of samples written, increases whenever there is a new one."""
+        return self._lib.pet_pose_channel_count(self._handle)
+
+    def close(self):
+        if self._handle:
+            self._lib.pet_pose_channel_close(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
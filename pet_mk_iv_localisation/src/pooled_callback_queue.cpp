@@ -0,0 +1,73 @@
+#include "pooled_callback_queue.h"
+
+#include <cstdint>
+#include <ctime>
+
+#include <ros/callback_queue.h>
+#include <ros/callback_queue_interface.h>
+
+#include "thread_pool.h"
+
+namespace pet
+{
+
+namespace
+{
+
+int64_t thread_cpu_time_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+} // namespace
+
+PooledCallbackQueue::PooledCallbackQueue(ThreadPool& pool)
+    : m_pool(pool)
+{
+}
+
+void PooledCallbackQueue::addCallback(const ros::CallbackInterfacePtr& callback, uint64_t owner_id)
+{
+    m_queue.addCallback(callback, owner_id);
+    if (m_pending.fetch_add(1) == 0) {
+        m_pool.submit([this]{ drain(); });
+    }
+}
+
+void PooledCallbackQueue::start()
+{
+    // Drain whatever was added while held. Callbacks added after this see a count of zero, or
+    // find this drain still running.
+    if (m_pending.fetch_sub(1) > 1) {
+        m_pool.submit([this]{ drain(); });
+    }
+}
+
+void PooledCallbackQueue::removeByID(uint64_t owner_id)
+{
+    m_queue.removeByID(owner_id);
+}
+
+void PooledCallbackQueue::drain()
+{
+    const int64_t start = thread_cpu_time_ns();
+
+    // Keep draining until no callback has been added since the last pass. Only one drain task
+    // exists at a time, since new tasks are only submitted when the pending count was zero.
+    int pending = m_pending.load();
+    while (true)
+    {
+        m_queue.callAvailable();
+        const int remaining = m_pending.fetch_sub(pending) - pending;
+        if (remaining == 0) {
+            break;
+        }
+        pending = remaining;
+    }
+
+    m_cpu_time_ns.fetch_add(thread_cpu_time_ns() - start, std::memory_order_relaxed);
+}
+
+} // namespace pet
@@ -0,0 +1,128 @@
+#include "pose_channel_reader.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pose_channel_format.h"
+
+namespace pet
+{
+
+PoseChannelReader::~PoseChannelReader()
+{
+    close();
+}
+
+bool PoseChannelReader::open(const std::string& name)
+{
+    close();
+
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        m_error = "could not open [" + name + "]: " + std::strerror(errno);
+        return false;
+    }
+
+    struct stat status;
+    void* address = MAP_FAILED;
+    if (fstat(fd, &status) == 0 && static_cast<std::size_t>(status.st_size) >= sizeof(PoseChannelLayout)) {
+        address = mmap(nullptr, sizeof(PoseChannelLayout), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+
+    if (address == MAP_FAILED)
+    {
+        m_error = "could not map [" + name + "]";
+        return false;
+    }
+
+    const auto* layout = static_cast<const PoseChannelLayout*>(address);
+    if (layout->magic != PoseChannelLayout::kMagic || layout->version != PoseChannelLayout::kVersion)
+    {
+        m_error = "[" + name + "] is not a pose channel of version " + std::to_string(PoseChannelLayout::kVersion);
+        munmap(address, sizeof(PoseChannelLayout));
+        return false;
+    }
+
+    m_layout = layout;
+    return true;
+}
+
+void PoseChannelReader::close()
+{
+    if (m_layout != nullptr)
+    {
+        munmap(const_cast<PoseChannelLayout*>(m_layout), sizeof(PoseChannelLayout));
+        m_layout = nullptr;
+    }
+}
+
+bool PoseChannelReader::read(PoseSample& sample) const
+{
+    std::uint64_t words[PoseChannelLayout::kWords];
+
+    for (int attempt = 0; attempt < kMaxAttempts; ++attempt)
+    {
+        const std::uint64_t before = m_layout->sequence.load(std::memory_order_acquire);
+        if (before == 0) {
+            return false;
+        }
+        if (before & 1) {
+            continue;
+        }
+
+        for (std::size_t i = 0; i < PoseChannelLayout::kWords; ++i) {
+            words[i] = m_layout->payload[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (m_layout->sequence.load(std::memory_order_relaxed) == before)
+        {
+            std::memcpy(&sample, words, sizeof(sample));
+            return true;
+        }
+    }
+    return false;
+}
+
+std::uint64_t PoseChannelReader::count() const
+{
+    return m_layout->sequence.load(std::memory_order_acquire) / 2;
+}
+
+} // namespace pet
+
+void* pet_pose_channel_open(const char* name)
+{
+    auto* reader = new (std::nothrow) pet::PoseChannelReader;
+    if (reader != nullptr && !reader->open(name))
+    {
+        delete reader;
+        return nullptr;
+    }
+    return reader;
+}
+
+int pet_pose_channel_read(const void* channel, pet::PoseSample* sample)
+{
+    return static_cast<const pet::PoseChannelReader*>(channel)->read(*sample) ? 1 : 0;
+}
+
+std::uint64_t pet_pose_channel_count(const void* channel)
+{
+    return static_cast<const pet::PoseChannelReader*>(channel)->count();
+}
+
+void pet_pose_channel_close(void* channel)
+{
+    delete static_cast<pet::PoseChannelReader*>(channel);
+}
@@ -0,0 +1,82 @@
+#include "pose_channel_writer.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <ros/ros.h>
+
+#include "pose_channel_format.h"
+
+namespace pet
+{
+
+PoseChannelWriter::~PoseChannelWriter()
+{
+    close();
+}
+
+bool PoseChannelWriter::open(const std::string& name)
+{
+    close();
+
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        ROS_ERROR("Could not open pose channel [%s]: %s", name.c_str(), std::strerror(errno));
+        return false;
+    }
+
+    void* address = MAP_FAILED;
+    if (ftruncate(fd, sizeof(PoseChannelLayout)) == 0) {
+        address = mmap(nullptr, sizeof(PoseChannelLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    const int error = errno;
+    ::close(fd);
+
+    if (address == MAP_FAILED)
+    {
+        ROS_ERROR("Could not map pose channel [%s]: %s", name.c_str(), std::strerror(error));
+        return false;
+    }
+
+    m_layout = static_cast<PoseChannelLayout*>(address);
+    m_layout->magic = PoseChannelLayout::kMagic;
+    m_layout->version = PoseChannelLayout::kVersion;
+
+    // A segment left by a previous run keeps counting, so readers see the restart as new data. If
+    // that run died while writing, the odd sequence is rounded up to mark the payload complete.
+    m_sequence = (m_layout->sequence.load(std::memory_order_relaxed) + 1) & ~std::uint64_t{1};
+    m_layout->sequence.store(m_sequence, std::memory_order_release);
+    return true;
+}
+
+void PoseChannelWriter::close()
+{
+    if (m_layout != nullptr)
+    {
+        munmap(m_layout, sizeof(PoseChannelLayout));
+        m_layout = nullptr;
+    }
+}
+
+void PoseChannelWriter::write(const PoseSample& sample)
+{
+    std::uint64_t words[PoseChannelLayout::kWords];
+    std::memcpy(words, &sample, sizeof(words));
+
+    m_layout->sequence.store(m_sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < PoseChannelLayout::kWords; ++i) {
+        m_layout->payload[i].store(words[i], std::memory_order_relaxed);
+    }
+    m_sequence += 2;
+    m_layout->sequence.store(m_sequence, std::memory_order_release);
+}
+
+} // namespace pet
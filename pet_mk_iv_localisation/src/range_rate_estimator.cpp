@@ -0,0 +1,107 @@
+#include "range_rate_estimator.h"
+
+#include <algorithm>
+
+#include <ros/time.h>
+
+namespace pet
+{
+
+RangeRateEstimator::RangeRateEstimator(int window_size)
+    : m_window_size(std::clamp(window_size, kMinSamples, kMaxWindowSize))
+{
+}
+
+void RangeRateEstimator::add(const ros::Time& stamp, double range)
+{
+    if (m_count == 0) {
+        m_reference = stamp;
+    }
+    const double t = (stamp - m_reference).toSec();
+
+    if (m_count == m_window_size)
+    {
+        const double old_t = m_t[m_next];
+        const double old_r = m_range[m_next];
+        m_sum_t  -= old_t;
+        m_sum_r  -= old_r;
+        m_sum_tt -= old_t * old_t;
+        m_sum_tr -= old_t * old_r;
+        m_sum_rr -= old_r * old_r;
+    }
+    else
+    {
+        ++m_count;
+    }
+
+    m_t[m_next] = t;
+    m_range[m_next] = range;
+    m_sum_t  += t;
+    m_sum_r  += range;
+    m_sum_tt += t * t;
+    m_sum_tr += t * range;
+    m_sum_rr += range * range;
+
+    m_next = (m_next + 1) % m_window_size;
+
+    // Once per lap of the window, move the reference and recompute the sums so that neither
+    // the growing times nor rounding errors degrade them.
+    if (m_next == 0) {
+        recompute_sums();
+    }
+
+    if (m_count >= kMinSamples) {
+        fit();
+    }
+}
+
+void RangeRateEstimator::reset()
+{
+    m_next = 0;
+    m_count = 0;
+    m_sum_t = m_sum_r = m_sum_tt = m_sum_tr = m_sum_rr = 0.0;
+    m_has_estimate = false;
+    m_rate = 0.0;
+    m_variance = 0.0;
+}
+
+void RangeRateEstimator::recompute_sums()
+{
+    const double oldest = *std::min_element(m_t.begin(), m_t.begin() + m_count);
+    m_reference += ros::Duration{oldest};
+
+    m_sum_t = m_sum_r = m_sum_tt = m_sum_tr = m_sum_rr = 0.0;
+    for (int i = 0; i < m_count; ++i)
+    {
+        m_t[i] -= oldest;
+        m_sum_t  += m_t[i];
+        m_sum_r  += m_range[i];
+        m_sum_tt += m_t[i] * m_t[i];
+        m_sum_tr += m_t[i] * m_range[i];
+        m_sum_rr += m_range[i] * m_range[i];
+    }
+}
+
+void RangeRateEstimator::fit()
+{
+    const double n = m_count;
+
+    // Centred sums of squares and products.
+    const double s_tt = m_sum_tt - m_sum_t * m_sum_t / n;
+    const double s_tr = m_sum_tr - m_sum_t * m_sum_r / n;
+    const double s_rr = m_sum_rr - m_sum_r * m_sum_r / n;
+
+    // Samples too close in time to tell a slope from noise.
+    m_has_estimate = s_tt > 1e-9;
+    if (!m_has_estimate) {
+        return;
+    }
+
+    m_rate = s_tr / s_tt;
+
+    // Residual variance of the fit, and from it the variance of the slope.
+    const double residual = std::max(0.0, s_rr - m_rate * s_tr) / (n - 2.0);
+    m_variance = std::max(residual / s_tt, kMinVariance);
+}
+
+} // namespace pet
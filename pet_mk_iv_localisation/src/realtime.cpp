@@ -0,0 +1,136 @@
+#include "realtime.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <alloca.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include <ros/ros.h>
+
+namespace pet::realtime
+{
+
+namespace
+{
+
+constexpr std::int64_t kNanoseconds = 1000000000;
+
+void prefault_stack(std::size_t size)
+{
+    // Touch every page so the stack never grows by faulting in the real-time path.
+    volatile unsigned char* stack = static_cast<unsigned char*>(alloca(size));
+    for (std::size_t i = 0; i < size; i += 4096) {
+        stack[i] = 0;
+    }
+}
+
+} // namespace
+
+bool set_fifo_priority(int priority)
+{
+    sched_param param{};
+    param.sched_priority = priority;
+    if (const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param); error != 0)
+    {
+        ROS_ERROR("Could not set SCHED_FIFO priority [%d]: %s", priority, std::strerror(error));
+        return false;
+    }
+    return true;
+}
+
+bool set_idle_priority()
+{
+    const sched_param param{};
+    if (const int error = pthread_setschedparam(pthread_self(), SCHED_IDLE, &param); error != 0)
+    {
+        ROS_ERROR("Could not set SCHED_IDLE scheduling: %s", std::strerror(error));
+        return false;
+    }
+    return true;
+}
+
+bool set_cpu_affinity(const std::vector<int>& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    if (const int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); error != 0)
+    {
+        ROS_ERROR("Could not set CPU affinity: %s", std::strerror(error));
+        return false;
+    }
+    return true;
+}
+
+bool lock_memory(std::size_t stack_size)
+{
+    // Freed memory stays with the process, and large blocks come from the locked heap.
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        ROS_ERROR("Could not lock memory: %s", std::strerror(errno));
+        return false;
+    }
+
+    prefault_stack(stack_size);
+    return true;
+}
+
+DeadlineScheduler::DeadlineScheduler(double period)
+    : m_period(static_cast<std::int64_t>(period * kNanoseconds))
+{
+}
+
+void DeadlineScheduler::start()
+{
+    m_deadline = now() + m_period;
+}
+
+double DeadlineScheduler::remaining() const
+{
+    return static_cast<double>(m_deadline - now()) / kNanoseconds;
+}
+
+double DeadlineScheduler::wait()
+{
+    const timespec deadline{static_cast<time_t>(m_deadline / kNanoseconds), static_cast<long>(m_deadline % kNanoseconds)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {}
+
+    const double lateness = static_cast<double>(now() - m_deadline) / kNanoseconds;
+    m_statistics.max_lateness = std::max(m_statistics.max_lateness, lateness);
+    return lateness;
+}
+
+std::uint64_t DeadlineScheduler::complete()
+{
+    const std::int64_t end = now();
+    m_statistics.max_duration = std::max(m_statistics.max_duration, static_cast<double>(end - m_deadline) / kNanoseconds);
+    ++m_statistics.cycles;
+
+    // Deadlines which passed during the cycle are skipped, not caught up on.
+    const std::uint64_t missed = (end > m_deadline + m_period) ? static_cast<std::uint64_t>((end - m_deadline) / m_period) : 0;
+    m_deadline += static_cast<std::int64_t>(missed + 1) * m_period;
+    m_statistics.missed += missed;
+    return missed;
+}
+
+std::int64_t DeadlineScheduler::now()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<std::int64_t>(time.tv_sec) * kNanoseconds + time.tv_nsec;
+}
+
+} // namespace pet::realtime
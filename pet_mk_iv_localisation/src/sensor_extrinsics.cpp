@@ -0,0 +1,16 @@
+#include "sensor_extrinsics.h"
+
+#include <geometry_msgs/Transform.h>
+
+#include <ugl_ros/convert_tf2.h>
+
+namespace pet
+{
+
+SensorExtrinsics::SensorExtrinsics(const geometry_msgs::Transform& transform)
+    : rotation(tf2::fromMsg(transform.rotation).toRotationMatrix())
+    , lever_arm(tf2::fromMsg(transform.translation))
+{
+}
+
+} // namespace pet
@@ -0,0 +1,233 @@
+#include "shadow_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "cpu_governor.h"
+#include "realtime.h"
+
+namespace pet
+{
+
+ShadowFilter::ShadowFilter(const KalmanFilter& initial, const Config& config, std::size_t capacity, double poll_period)
+    : m_filter(initial)
+    , m_config(config)
+    , m_poll_period(poll_period)
+    , m_inputs(std::max<std::size_t>(capacity, 2))
+{
+    m_filter.set_process_noise(m_config.process_noise);
+    m_thread = std::thread{&ShadowFilter::run, this};
+}
+
+ShadowFilter::~ShadowFilter()
+{
+    m_stop.store(true, std::memory_order_release);
+    m_thread.join();
+}
+
+void ShadowFilter::predict(double dt, const ugl::Vector3& acc, const ugl::Vector3& ang_vel)
+{
+    push(Predict{dt, acc, ang_vel});
+}
+
+void ShadowFilter::command_predict(double dt, double linear_vel, double angular_vel)
+{
+    push(CommandPredict{dt, linear_vel, angular_vel});
+}
+
+void ShadowFilter::sonar_velocity_update(int count, const ugl::Vector<kMaxSonars>& velocities,
+                                         const ugl::Vector<kMaxSonars>& directions, const ugl::Vector<kMaxSonars>& variances)
+{
+    push(SonarVelocityUpdate{count, velocities, directions, variances});
+}
+
+void ShadowFilter::zero_velocity_update()
+{
+    push(ZeroVelocityUpdate{});
+}
+
+void ShadowFilter::compare(const ros::Time& stamp, const KalmanFilter& primary)
+{
+    Compare input{stamp, m_dropping, {}, primary.covariance()};
+    input.state << primary.heading(), primary.velocity(), primary.position();
+    if (push(input)) {
+        m_dropping = false;
+    }
+}
+
+bool ShadowFilter::push(const Input& input)
+{
+    // Once a step is lost the shadow can not follow, so only a state restarts it.
+    if (m_dropping && !std::holds_alternative<Compare>(input))
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) == m_inputs.size())
+    {
+        m_dropping = true;
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    m_inputs[head % m_inputs.size()] = input;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+void ShadowFilter::run()
+{
+    realtime::set_idle_priority();
+
+    m_report_time = std::chrono::steady_clock::now();
+    m_report_cpu_time = CpuGovernor::thread_cpu_time();
+    while (!m_stop.load(std::memory_order_acquire))
+    {
+        drain();
+        m_cpu_time.store(CpuGovernor::thread_cpu_time(), std::memory_order_relaxed);
+        std::this_thread::sleep_for(m_poll_period);
+    }
+}
+
+void ShadowFilter::drain()
+{
+    const std::size_t head = m_head.load(std::memory_order_acquire);
+    std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    for (; tail != head; ++tail)
+    {
+        apply(m_inputs[tail % m_inputs.size()]);
+        // Hand back slots as they are done, not only once caught up.
+        m_tail.store(tail + 1, std::memory_order_release);
+    }
+}
+
+void ShadowFilter::apply(const Input& input)
+{
+    if (const auto* predict = std::get_if<Predict>(&input))
+    {
+        m_filter.predict(predict->dt, predict->acc, predict->ang_vel);
+    }
+    else if (const auto* command = std::get_if<CommandPredict>(&input))
+    {
+        m_filter.command_predict(command->dt, command->linear_vel, command->angular_vel);
+    }
+    else if (const auto* sonar = std::get_if<SonarVelocityUpdate>(&input))
+    {
+        static_assert(kMaxSonars == 3, "Dispatch below must cover every possible number of sonars.");
+
+        const ugl::Vector<kMaxSonars> variances = sonar->variances * m_config.sonar_variance_scale;
+        const auto lateral = KalmanFilter::pseudo_lateral_velocity_observation(0.0);
+        switch (sonar->count)
+        {
+        case 1:
+            m_filter.update(KalmanFilter::sonar_velocity_observation<1>(sonar->velocities.head<1>(), sonar->directions.head<1>(), variances.head<1>()), lateral);
+            break;
+        case 2:
+            m_filter.update(KalmanFilter::sonar_velocity_observation<2>(sonar->velocities.head<2>(), sonar->directions.head<2>(), variances.head<2>()), lateral);
+            break;
+        case 3:
+            m_filter.update(KalmanFilter::sonar_velocity_observation<3>(sonar->velocities, sonar->directions, variances), lateral);
+            break;
+        default:
+            m_filter.update(lateral);
+            break;
+        }
+    }
+    else if (std::holds_alternative<ZeroVelocityUpdate>(input))
+    {
+        m_filter.zero_velocity_update();
+    }
+    else if (const auto* primary = std::get_if<Compare>(&input))
+    {
+        evaluate(*primary);
+    }
+}
+
+void ShadowFilter::evaluate(const Compare& primary)
+{
+    if (primary.resync)
+    {
+        m_filter.set_heading(primary.state[0]);
+        m_filter.set_velocity(primary.state.segment<2>(1));
+        m_filter.set_position(primary.state.segment<2>(3));
+        m_filter.set_covariance(primary.covariance);
+        m_max_position = 0.0;
+        ++m_resyncs;
+    }
+
+    Report report;
+    report.stamp = primary.stamp;
+    Eigen::Map<ugl::Vector<5>> state{report.state};
+    state << m_filter.heading(), m_filter.velocity(), m_filter.position();
+
+    ugl::Vector<5> difference = state - primary.state;
+    difference[0] = std::remainder(difference[0], 2.0 * M_PI);
+
+    report.position = difference.segment<2>(3).norm();
+    report.heading = difference[0];
+    report.velocity = difference.segment<2>(1).norm();
+    report.normalised = difference.dot(primary.covariance.ldlt().solve(difference));
+
+    m_max_position = std::max(m_max_position, report.position);
+    report.max_position = m_max_position;
+
+    const auto now = std::chrono::steady_clock::now();
+    const double cpu_time = CpuGovernor::thread_cpu_time();
+    const std::chrono::duration<double> elapsed = now - m_report_time;
+    report.cpu_share = elapsed.count() > 0.0 ? (cpu_time - m_report_cpu_time) / elapsed.count() : 0.0;
+    m_report_time = now;
+    m_report_cpu_time = cpu_time;
+
+    report.dropped = m_dropped.load(std::memory_order_relaxed);
+    report.resyncs = m_resyncs;
+
+    store_report(report);
+}
+
+void ShadowFilter::store_report(const Report& report)
+{
+    std::uint64_t words[kReportWords] = {};
+    std::memcpy(words, &report, sizeof(report));
+
+    const std::uint64_t sequence = m_report_sequence.load(std::memory_order_relaxed);
+    m_report_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < kReportWords; ++i) {
+        m_report_words[i].store(words[i], std::memory_order_relaxed);
+    }
+    m_report_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool ShadowFilter::latest_report(Report& report)
+{
+    std::uint64_t words[kReportWords];
+
+    for (int attempt = 0; attempt < kMaxReadAttempts; ++attempt)
+    {
+        const std::uint64_t before = m_report_sequence.load(std::memory_order_acquire);
+        if (before == m_report_read) {
+            return false;
+        }
+        if (before & 1) {
+            continue;
+        }
+
+        for (std::size_t i = 0; i < kReportWords; ++i) {
+            words[i] = m_report_words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (m_report_sequence.load(std::memory_order_relaxed) == before)
+        {
+            std::memcpy(&report, words, sizeof(report));
+            m_report_read = before;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace pet
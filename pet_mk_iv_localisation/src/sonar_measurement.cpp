@@ -1,15 +1,26 @@
 #include "sonar_measurement.h"
 
 #include <pet_mk_iv_msgs/DistanceMeasurement.h>
+#include <sensor_msgs/Range.h>
+
+#include <ros/time.h>
 
 #include "measurement.h"
 
 namespace pet
 {
 
-SonarMeasurement::SonarMeasurement(const pet_mk_iv_msgs::DistanceMeasurement& sonar_msg)
-    : Measurement(sonar_msg.header.stamp)
-    , m_distance(sonar_msg.distance * 1000.0)
+SonarMeasurement::SonarMeasurement(const pet_mk_iv_msgs::DistanceMeasurement& sonar_msg, int sensor_index, const ros::Time& stamp)
+    : Measurement(stamp)
+    , m_distance(sonar_msg.distance / 1000.0)
+    , m_sensor_index(sensor_index)
+{
+}
+
+SonarMeasurement::SonarMeasurement(const sensor_msgs::Range& range_msg, int sensor_index, const ros::Time& stamp)
+    : Measurement(stamp)
+    , m_distance(range_msg.range)
+    , m_sensor_index(sensor_index)
 {
 }
 
@@ -1 +1,54 @@
-#include "startup_utility.h"
\ No newline at end of file
+#include "startup_utility.h"
+
+#include <algorithm>
+#include <string>
+
+#include <ros/ros.h>
+
+namespace pet::utility
+{
+
+int ReadinessBarrier::add(const std::string& topic)
+{
+    Topic entry;
+    entry.name = topic;
+    m_topics.push_back(entry);
+    return static_cast<int>(m_topics.size()) - 1;
+}
+
+void ReadinessBarrier::start(const ros::Time& now, const ros::Duration& timeout)
+{
+    m_start = now;
+    m_deadline = now + timeout;
+    m_passed = false;
+}
+
+bool ReadinessBarrier::check(const ros::Time& now)
+{
+    if (m_passed) {
+        return true;
+    }
+
+    const bool all_ready = std::all_of(m_topics.begin(), m_topics.end(), [](const Topic& topic){ return topic.ready; });
+    if (all_ready || now >= m_deadline)
+    {
+        m_passed = true;
+        report(now);
+    }
+    return m_passed;
+}
+
+void ReadinessBarrier::report(const ros::Time& now) const
+{
+    for (const auto& topic : m_topics)
+    {
+        if (topic.ready) {
+            ROS_INFO("Recieved first message on topic [%s] after [%f] s.", topic.name.c_str(), (topic.ready_time - m_start).toSec());
+        }
+        else {
+            ROS_WARN("No message recieved on topic [%s] within [%f] s! Starting without it.", topic.name.c_str(), (now - m_start).toSec());
+        }
+    }
+}
+
+}
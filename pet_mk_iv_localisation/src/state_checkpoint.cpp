@@ -0,0 +1,149 @@
+#include "state_checkpoint.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <ros/ros.h>
+
+#include <ugl/math/vector.h>
+
+#include "kalman_filter.h"
+
+namespace pet
+{
+
+StateCheckpoint::~StateCheckpoint()
+{
+    if (m_file != nullptr)
+    {
+        msync(m_file, sizeof(File), MS_ASYNC);
+        munmap(m_file, sizeof(File));
+    }
+}
+
+bool StateCheckpoint::open(const std::string& path)
+{
+    static_assert(std::is_trivially_copyable_v<File>, "Checkpoint file layout must be plain data.");
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        ROS_WARN("Could not open checkpoint file [%s]: %s", path.c_str(), std::strerror(errno));
+        return false;
+    }
+
+    if (ftruncate(fd, sizeof(File)) != 0)
+    {
+        ROS_WARN("Could not resize checkpoint file [%s]: %s", path.c_str(), std::strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    void* address = mmap(nullptr, sizeof(File), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED)
+    {
+        ROS_WARN("Could not map checkpoint file [%s]: %s", path.c_str(), std::strerror(errno));
+        return false;
+    }
+
+    m_file = static_cast<File*>(address);
+
+    // New file, or one written by an incompatible version.
+    if (m_file->magic != kMagic || m_file->version != kVersion)
+    {
+        std::memset(m_file, 0, sizeof(File));
+        m_file->magic = kMagic;
+        m_file->version = kVersion;
+    }
+
+    const Slot* latest = latest_slot();
+    m_sequence = (latest != nullptr) ? latest->sequence : 0;
+
+    return true;
+}
+
+std::optional<StateCheckpoint::Checkpoint> StateCheckpoint::load() const
+{
+    const Slot* slot = is_open() ? latest_slot() : nullptr;
+    if (slot == nullptr) {
+        return std::nullopt;
+    }
+
+    Checkpoint checkpoint;
+    checkpoint.stamp.fromNSec(slot->stamp);
+    checkpoint.filter = KalmanFilter(slot->heading,
+                                     ugl::Vector<2>{slot->position[0], slot->position[1]},
+                                     ugl::Vector<2>{slot->velocity[0], slot->velocity[1]});
+    checkpoint.filter.set_covariance(Eigen::Map<const KalmanFilter::Covariance<5>>(slot->covariance));
+    return checkpoint;
+}
+
+void StateCheckpoint::save(const ros::Time& stamp, const KalmanFilter& filter)
+{
+    if (!is_open()) {
+        return;
+    }
+
+    // Overwrite the older slot, the latest one stays valid until this one is complete.
+    const std::uint64_t sequence = m_sequence + 1;
+    Slot& slot = m_file->slots[sequence % 2];
+
+    slot.sequence = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.stamp = stamp.toNSec();
+    slot.heading = filter.heading();
+    Eigen::Map<ugl::Vector<2>>(slot.velocity) = filter.velocity();
+    Eigen::Map<ugl::Vector<2>>(slot.position) = filter.position();
+    Eigen::Map<KalmanFilter::Covariance<5>>(slot.covariance) = filter.covariance();
+
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.checksum = checksum(slot);
+    slot.sequence = sequence;
+
+    m_sequence = sequence;
+}
+
+std::uint64_t StateCheckpoint::checksum(const Slot& slot)
+{
+    // FNV-1a over the payload between sequence and checksum.
+    const auto* begin = reinterpret_cast<const unsigned char*>(&slot) + offsetof(Slot, stamp);
+    const auto* end = reinterpret_cast<const unsigned char*>(&slot) + offsetof(Slot, checksum);
+
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (const auto* byte = begin; byte != end; ++byte)
+    {
+        hash ^= *byte;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool StateCheckpoint::is_valid(const Slot& slot)
+{
+    return slot.sequence != 0 && slot.checksum == checksum(slot);
+}
+
+const StateCheckpoint::Slot* StateCheckpoint::latest_slot() const
+{
+    const Slot* latest = nullptr;
+    for (const Slot& slot : m_file->slots)
+    {
+        if (is_valid(slot) && (latest == nullptr || slot.sequence > latest->sequence)) {
+            latest = &slot;
+        }
+    }
+    return latest;
+}
+
+} // namespace pet
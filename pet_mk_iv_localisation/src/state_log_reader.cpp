@@ -0,0 +1,113 @@
+#include "state_log_reader.h"
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "state_log_format.h"
+
+namespace pet
+{
+
+StateLogReader::~StateLogReader()
+{
+    close();
+}
+
+bool StateLogReader::open(const std::string& path)
+{
+    close();
+
+    m_fd = ::open(path.c_str(), O_RDONLY);
+    if (m_fd < 0)
+    {
+        m_error = "could not open [" + path + "]: " + std::strerror(errno);
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(m_fd, &status) != 0 || pread(m_fd, &m_header, sizeof(m_header), 0) != static_cast<ssize_t>(sizeof(m_header)))
+    {
+        m_error = "could not read header of [" + path + "]";
+        close();
+        return false;
+    }
+
+    if (m_header.magic != StateLogHeader::kMagic)
+    {
+        m_error = "[" + path + "] is not a state log";
+        close();
+        return false;
+    }
+    if (m_header.version != StateLogHeader::kVersion || m_header.header_size != sizeof(StateLogHeader) ||
+        m_header.record_size != sizeof(StateLogRecord))
+    {
+        m_error = "[" + path + "] has unsupported version " + std::to_string(m_header.version);
+        close();
+        return false;
+    }
+
+    // A log which was not closed properly may be longer than its records, but never shorter.
+    const std::uint64_t capacity = (static_cast<std::uint64_t>(status.st_size) - sizeof(StateLogHeader)) / sizeof(StateLogRecord);
+    m_size = (m_header.record_count < capacity) ? m_header.record_count : capacity;
+
+    return true;
+}
+
+void StateLogReader::close()
+{
+    if (m_window != nullptr)
+    {
+        munmap(const_cast<void*>(m_window), m_window_size);
+        m_window = nullptr;
+    }
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_size = 0;
+}
+
+const StateLogRecord* StateLogReader::map_window(std::uint64_t index)
+{
+    const std::uint64_t first = index / kWindowRecords * kWindowRecords;
+    const std::uint64_t count = (m_size - first < kWindowRecords) ? (m_size - first) : kWindowRecords;
+
+    // Mappings have to start on a page boundary.
+    const std::uint64_t page_size = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+    const std::uint64_t begin = sizeof(StateLogHeader) + first * sizeof(StateLogRecord);
+    const std::uint64_t offset = begin / page_size * page_size;
+    const std::size_t size = static_cast<std::size_t>(begin - offset + count * sizeof(StateLogRecord));
+
+    if (m_window == nullptr || m_window_offset != offset || m_window_size != size)
+    {
+        if (m_window != nullptr)
+        {
+            munmap(const_cast<void*>(m_window), m_window_size);
+            m_window = nullptr;
+        }
+
+        void* address = mmap(nullptr, size, PROT_READ, MAP_SHARED, m_fd, static_cast<off_t>(offset));
+        if (address == MAP_FAILED)
+        {
+            m_error = std::string{"could not map log: "} + std::strerror(errno);
+            return nullptr;
+        }
+        madvise(address, size, MADV_SEQUENTIAL);
+
+        m_window = address;
+        m_window_size = size;
+        m_window_offset = offset;
+    }
+
+    const auto* records = reinterpret_cast<const StateLogRecord*>(static_cast<const char*>(m_window) + (begin - offset));
+    return records + (index - first);
+}
+
+} // namespace pet
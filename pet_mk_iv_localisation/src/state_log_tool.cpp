@@ -0,0 +1,96 @@
+// Command line tool for binary filter state logs written by kalman_node.
+//
+//   state_log_tool info <log>
+//   state_log_tool csv <log> [first] [last]
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+
+#include "state_log_format.h"
+#include "state_log_reader.h"
+
+namespace
+{
+
+int usage()
+{
+    std::fprintf(stderr, "usage: state_log_tool info <log>\n"
+                         "       state_log_tool csv <log> [first] [last]\n");
+    return 2;
+}
+
+int info(const pet::StateLogReader& reader)
+{
+    const auto& header = reader.header();
+    const std::time_t created = static_cast<std::time_t>(header.created / 1000000000);
+
+    char created_string[64];
+    std::strftime(created_string, sizeof(created_string), "%F %T", std::localtime(&created));
+
+    std::printf("version: %" PRIu32 "\n", header.version);
+    std::printf("created: %s\n", created_string);
+    std::printf("records: %" PRIu64 "\n", reader.size());
+    return 0;
+}
+
+int csv(pet::StateLogReader& reader, std::uint64_t first, std::uint64_t last)
+{
+    std::printf("stamp,theta,vel_x,vel_y,pos_x,pos_y,var_theta,var_vel_x,var_vel_y,var_pos_x,var_pos_y,"
+                "innovation_size,innovation_0,innovation_1,innovation_2,innovation_3,innovation_nis,"
+                "processing_time,queue_latency,queue_depth\n");
+
+    const bool complete = reader.for_each([](std::uint64_t /*index*/, const pet::StateLogRecord& record)
+    {
+        std::printf("%" PRId64 ".%09" PRId64, record.stamp / 1000000000, record.stamp % 1000000000);
+        for (const double value : record.state) {
+            std::printf(",%.9g", value);
+        }
+        for (const double value : record.covariance_diagonal) {
+            std::printf(",%.9g", value);
+        }
+        std::printf(",%u", record.innovation_size);
+        for (const double value : record.innovation) {
+            std::printf(",%.9g", value);
+        }
+        std::printf(",%.9g,%.9g,%.9g,%u\n", record.innovation_nis, record.processing_time, record.queue_latency, record.queue_depth);
+    }, first, last);
+
+    if (!complete)
+    {
+        std::fprintf(stderr, "state_log_tool: %s\n", reader.error().c_str());
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        return usage();
+    }
+
+    const std::string command = argv[1];
+
+    pet::StateLogReader reader;
+    if (!reader.open(argv[2]))
+    {
+        std::fprintf(stderr, "state_log_tool: %s\n", reader.error().c_str());
+        return 1;
+    }
+
+    if (command == "info") {
+        return info(reader);
+    }
+    if (command == "csv")
+    {
+        const std::uint64_t first = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 0;
+        const std::uint64_t last = (argc > 4) ? std::strtoull(argv[4], nullptr, 10) : UINT64_MAX;
+        return csv(reader, first, last);
+    }
+    return usage();
+}
@@ -0,0 +1,142 @@
+#include "state_log_writer.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <ros/ros.h>
+
+#include "state_log_format.h"
+
+namespace pet
+{
+
+StateLogWriter::~StateLogWriter()
+{
+    close();
+}
+
+bool StateLogWriter::open(const std::string& path)
+{
+    close();
+
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0)
+    {
+        ROS_WARN("Could not open state log [%s]: %s", path.c_str(), std::strerror(errno));
+        return false;
+    }
+    m_path = path;
+
+    if (!map_window(0))
+    {
+        close();
+        return false;
+    }
+
+    void* address = mmap(nullptr, sizeof(StateLogHeader), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (address == MAP_FAILED)
+    {
+        ROS_WARN("Could not map state log [%s]: %s", path.c_str(), std::strerror(errno));
+        close();
+        return false;
+    }
+    m_header = static_cast<StateLogHeader*>(address);
+
+    const auto created = std::chrono::system_clock::now().time_since_epoch();
+    m_header->magic = StateLogHeader::kMagic;
+    m_header->version = StateLogHeader::kVersion;
+    m_header->header_size = sizeof(StateLogHeader);
+    m_header->record_size = sizeof(StateLogRecord);
+    m_header->record_count = 0;
+    m_header->created = std::chrono::duration_cast<std::chrono::nanoseconds>(created).count();
+
+    ROS_INFO("Logging filter state to [%s].", path.c_str());
+    return true;
+}
+
+void StateLogWriter::close()
+{
+    if (m_window_address != nullptr)
+    {
+        munmap(m_window_address, kChunkSize);
+        m_window_address = nullptr;
+        m_window = nullptr;
+    }
+    if (m_header != nullptr)
+    {
+        // Drop the unused part of the last chunk.
+        const off_t used = sizeof(StateLogHeader) + m_header->record_count * sizeof(StateLogRecord);
+        munmap(m_header, sizeof(StateLogHeader));
+        m_header = nullptr;
+
+        if (ftruncate(m_fd, used) != 0) {
+            ROS_WARN("Could not trim state log [%s]: %s", m_path.c_str(), std::strerror(errno));
+        }
+    }
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void StateLogWriter::append(const StateLogRecord& record)
+{
+    if (!is_open()) {
+        return;
+    }
+
+    const std::uint64_t count = m_header->record_count;
+    if (count == m_window_end && !map_window(count))
+    {
+        ROS_ERROR("State log [%s] could not be grown. Logging stopped.", m_path.c_str());
+        close();
+        return;
+    }
+
+    m_window[count - m_window_first] = record;
+
+    // The record must be complete before it is counted.
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->record_count = count + 1;
+}
+
+bool StateLogWriter::map_window(std::uint64_t first)
+{
+    // Mappings have to start on a page boundary, which need not be a record boundary.
+    const std::uint64_t page_size = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+    const std::uint64_t begin = sizeof(StateLogHeader) + first * sizeof(StateLogRecord);
+    const std::uint64_t offset = begin / page_size * page_size;
+
+    if (ftruncate(m_fd, static_cast<off_t>(offset + kChunkSize)) != 0)
+    {
+        ROS_WARN("Could not resize state log [%s]: %s", m_path.c_str(), std::strerror(errno));
+        return false;
+    }
+
+    void* address = mmap(nullptr, kChunkSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, static_cast<off_t>(offset));
+    if (address == MAP_FAILED)
+    {
+        ROS_WARN("Could not map state log [%s]: %s", m_path.c_str(), std::strerror(errno));
+        return false;
+    }
+
+    if (m_window_address != nullptr) {
+        munmap(m_window_address, kChunkSize);
+    }
+
+    m_window_address = address;
+    m_window = reinterpret_cast<StateLogRecord*>(static_cast<char*>(address) + (begin - offset));
+    m_window_first = first;
+    m_window_end = first + (offset + kChunkSize - begin) / sizeof(StateLogRecord);
+    return true;
+}
+
+} // namespace pet
@@ -0,0 +1,102 @@
+#include "stationary_detector.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pet
+{
+
+StationaryDetector::StationaryDetector(int window, double acc_variance, double rate_variance, double max_rate)
+    : m_samples(static_cast<std::size_t>(std::max(window, 2)))
+    , m_acc_variance(acc_variance)
+    , m_rate_variance(rate_variance)
+    , m_max_rate(max_rate)
+{
+}
+
+void StationaryDetector::add(const ugl::Vector3& acc, const ugl::Vector3& rate)
+{
+    if (m_samples.empty()) {
+        return;
+    }
+
+    const Sample sample{acc.x(), acc.y(), acc.z(), rate.x(), rate.y(), rate.z()};
+    const int window = static_cast<int>(m_samples.size());
+
+    if (m_count == window)
+    {
+        const Sample& old = m_samples[m_next];
+        for (std::size_t i = 0; i < sample.size(); ++i)
+        {
+            m_sum[i] -= old[i];
+            m_sum_squares[i] -= old[i] * old[i];
+        }
+    }
+    else
+    {
+        ++m_count;
+    }
+
+    m_samples[m_next] = sample;
+    for (std::size_t i = 0; i < sample.size(); ++i)
+    {
+        m_sum[i] += sample[i];
+        m_sum_squares[i] += sample[i] * sample[i];
+    }
+
+    m_next = (m_next + 1) % window;
+
+    // Recompute the sums once per lap of the window so that rounding errors do not accumulate.
+    if (m_next == 0)
+    {
+        m_sum.fill(0.0);
+        m_sum_squares.fill(0.0);
+        for (int j = 0; j < m_count; ++j)
+        {
+            for (std::size_t i = 0; i < sample.size(); ++i)
+            {
+                m_sum[i] += m_samples[j][i];
+                m_sum_squares[i] += m_samples[j][i] * m_samples[j][i];
+            }
+        }
+    }
+
+    evaluate();
+}
+
+void StationaryDetector::reset()
+{
+    m_next = 0;
+    m_count = 0;
+    m_sum.fill(0.0);
+    m_sum_squares.fill(0.0);
+    m_stationary = false;
+}
+
+void StationaryDetector::evaluate()
+{
+    // Nothing is claimed before the window has filled once.
+    if (m_count < static_cast<int>(m_samples.size()))
+    {
+        m_stationary = false;
+        return;
+    }
+
+    const double n = m_count;
+    double acc_variance = 0.0;
+    double rate_variance = 0.0;
+    double rate_squared = 0.0;
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        const double acc_mean = m_sum[i] / n;
+        const double rate_mean = m_sum[i + 3] / n;
+        acc_variance += std::max(0.0, m_sum_squares[i] / n - acc_mean * acc_mean);
+        rate_variance += std::max(0.0, m_sum_squares[i + 3] / n - rate_mean * rate_mean);
+        rate_squared += rate_mean * rate_mean;
+    }
+
+    // Turning at a constant rate has low variance as well.
+    m_stationary = acc_variance < m_acc_variance && rate_variance < m_rate_variance && rate_squared < m_max_rate * m_max_rate;
+}
+
+} // namespace pet
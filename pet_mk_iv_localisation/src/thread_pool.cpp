@@ -0,0 +1,128 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace pet
+{
+
+namespace
+{
+
+// Index of the worker running on the current thread, or -1 for other threads.
+thread_local int t_worker_index = -1;
+thread_local const void* t_worker_pool = nullptr;
+
+} // namespace
+
+ThreadPool::ThreadPool(int num_threads)
+{
+    if (num_threads <= 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (int i = 0; i < num_threads; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (int i = 0; i < num_threads; ++i) {
+        m_threads.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+void ThreadPool::submit(Task task)
+{
+    // Tasks submitted from a worker stay on that worker, which keeps their data in its cache.
+    const int index = (t_worker_pool == this)
+        ? t_worker_index
+        : static_cast<int>(m_next_worker++ % m_workers.size());
+
+    {
+        std::lock_guard<std::mutex> lock{m_workers[index]->mutex};
+        m_workers[index]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock{m_wake_mutex};
+        ++m_queued;
+    }
+    m_wake.notify_one();
+}
+
+void ThreadPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_wake_mutex};
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& thread : m_threads)
+    {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+void ThreadPool::run(int index)
+{
+    t_worker_index = index;
+    t_worker_pool = this;
+
+    while (true)
+    {
+        Task task;
+        if (try_pop(index, task))
+        {
+            {
+                std::lock_guard<std::mutex> lock{m_wake_mutex};
+                --m_queued;
+            }
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock{m_wake_mutex};
+        m_wake.wait(lock, [this]{ return m_stop || m_queued > 0; });
+        if (m_stop && m_queued == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::try_pop(int index, Task& task)
+{
+    {
+        Worker& own = *m_workers[index];
+        std::lock_guard<std::mutex> lock{own.mutex};
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    const int num_workers = static_cast<int>(m_workers.size());
+    for (int offset = 1; offset < num_workers; ++offset)
+    {
+        Worker& victim = *m_workers[(index + offset) % num_workers];
+        std::lock_guard<std::mutex> lock{victim.mutex};
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace pet
@@ -0,0 +1,117 @@
+// Checks that ClockOffsetEstimator converts remote stamps to local time without the transport
+// delay, follows a skewed remote clock and starts over when the remote clock jumps.
+
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include <ros/time.h>
+
+#include "clock_offset_estimator.h"
+
+namespace pet
+{
+namespace
+{
+
+constexpr double kPeriod = 0.1;
+constexpr double kOffset = 1000.0;
+
+// Transport delays in [min, min + spread], from a fixed seed so that failures can be reproduced.
+class Delays
+{
+public:
+    Delays(double min, double spread)
+        : m_min(min)
+        , m_spread(spread)
+    {
+    }
+
+    double next()
+    {
+        m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return m_min + m_spread * static_cast<double>(m_state >> 11) / static_cast<double>(1ULL << 53);
+    }
+
+private:
+    double m_min;
+    double m_spread;
+    std::uint64_t m_state = 1;
+};
+
+TEST(ClockOffsetEstimator, constantOffsetWithJitteredDelays)
+{
+    ClockOffsetEstimator estimator;
+    Delays delays{0.001, 0.009};
+
+    for (int i = 0; i < 500; ++i)
+    {
+        const double remote = 50.0 + i * kPeriod;
+        const ros::Time arrival{remote + kOffset + delays.next()};
+        const ros::Time corrected = estimator.correct(ros::Time{remote}, arrival);
+
+        EXPECT_LE(corrected, arrival) << "sample " << i;
+        if (i >= 20)
+        {
+            // Off by the fastest delay and the slope fitted to the jitter, well within the jitter.
+            EXPECT_NEAR(corrected.toSec(), remote + kOffset, 0.004) << "sample " << i;
+            EXPECT_NEAR(estimator.offset(), kOffset, 0.004) << "sample " << i;
+        }
+    }
+    EXPECT_NEAR(estimator.skew(), 1.0, 1e-3);
+}
+
+TEST(ClockOffsetEstimator, skewedClock)
+{
+    // The remote clock runs 200 ppm slow, 0.1 s behind after 500 s.
+    constexpr double kSkew = 1.0002;
+
+    ClockOffsetEstimator estimator;
+    Delays delays{0.001, 0.002};
+
+    for (int i = 0; i < 5000; ++i)
+    {
+        const double remote = 50.0 + i * kPeriod;
+        const double local = kOffset + kSkew * remote;
+        const ros::Time corrected = estimator.correct(ros::Time{remote}, ros::Time{local + delays.next()});
+
+        if (i >= 100) {
+            EXPECT_NEAR(corrected.toSec(), local, 0.003) << "sample " << i;
+        }
+    }
+    EXPECT_NEAR(estimator.skew(), kSkew, 1e-4);
+    EXPECT_NEAR(estimator.offset(), kOffset + (kSkew - 1.0) * (50.0 + 4999 * kPeriod), 0.003);
+}
+
+TEST(ClockOffsetEstimator, resetOnJump)
+{
+    ClockOffsetEstimator estimator;
+    Delays delays{0.001, 0.004};
+
+    double local = 2000.0;
+    for (int i = 0; i < 100; ++i)
+    {
+        local += kPeriod;
+        estimator.correct(ros::Time{local - kOffset}, ros::Time{local + delays.next()});
+    }
+
+    // The remote clock restarts from zero, e.g. after an MCU reset. The first stamp after the jump
+    // is passed through until a new line has been fitted.
+    const double restart = local;
+    local += kPeriod;
+    const ros::Time first{local - restart};
+    EXPECT_EQ(estimator.correct(first, ros::Time{local + delays.next()}), first);
+
+    for (int i = 0; i < 50; ++i)
+    {
+        local += kPeriod;
+        const ros::Time corrected = estimator.correct(ros::Time{local - restart}, ros::Time{local + delays.next()});
+        if (i >= 20) {
+            EXPECT_NEAR(corrected.toSec(), local, 0.002) << "sample " << i;
+        }
+    }
+    EXPECT_NEAR(estimator.offset(), restart, 0.002);
+}
+
+} // namespace
+} // namespace pet
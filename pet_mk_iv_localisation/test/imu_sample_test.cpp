@@ -0,0 +1,102 @@
+// Checks that ImuSample decodes the fields it uses from a serialised sensor_msgs/Imu, and
+// consumes exactly the whole message, whatever the length of the frame id.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ros/serialization.h>
+#include <sensor_msgs/Imu.h>
+
+#include "imu_sample.h"
+
+namespace pet
+{
+namespace
+{
+
+sensor_msgs::Imu make_imu(const std::string& frame_id)
+{
+    sensor_msgs::Imu imu;
+    imu.header.seq = 7;
+    imu.header.stamp = ros::Time{1234, 567890};
+    imu.header.frame_id = frame_id;
+    imu.orientation.w = 1.0;
+    imu.orientation_covariance.fill(-1.0);
+    imu.angular_velocity.x = 0.1;
+    imu.angular_velocity.y = -0.2;
+    imu.angular_velocity.z = 0.3;
+    imu.angular_velocity_covariance.fill(0.01);
+    imu.linear_acceleration.x = 1.5;
+    imu.linear_acceleration.y = -2.5;
+    imu.linear_acceleration.z = 9.81;
+    imu.linear_acceleration_covariance.fill(0.02);
+    return imu;
+}
+
+ImuSample decode(const sensor_msgs::Imu& imu, std::uint32_t& remaining)
+{
+    namespace ser = ros::serialization;
+
+    std::vector<std::uint8_t> buffer(ser::serializationLength(imu));
+    ser::OStream out{buffer.data(), static_cast<std::uint32_t>(buffer.size())};
+    ser::serialize(out, imu);
+
+    ImuSample sample;
+    ser::IStream in{buffer.data(), static_cast<std::uint32_t>(buffer.size())};
+    ser::deserialize(in, sample);
+    remaining = in.getLength();
+    return sample;
+}
+
+} // namespace
+
+TEST(ImuSample, decodesUsedFields)
+{
+    for (const std::string& frame_id : {std::string{}, std::string{"imu_link"}, std::string(300, 'x')})
+    {
+        const auto imu = make_imu(frame_id);
+        std::uint32_t remaining = 1;
+        const ImuSample sample = decode(imu, remaining);
+
+        EXPECT_EQ(remaining, 0u) << "frame_id of length " << frame_id.size();
+        EXPECT_EQ(sample.stamp, imu.header.stamp);
+        EXPECT_DOUBLE_EQ(sample.angular_velocity.x(), imu.angular_velocity.x);
+        EXPECT_DOUBLE_EQ(sample.angular_velocity.y(), imu.angular_velocity.y);
+        EXPECT_DOUBLE_EQ(sample.angular_velocity.z(), imu.angular_velocity.z);
+        EXPECT_DOUBLE_EQ(sample.linear_acceleration.x(), imu.linear_acceleration.x);
+        EXPECT_DOUBLE_EQ(sample.linear_acceleration.y(), imu.linear_acceleration.y);
+        EXPECT_DOUBLE_EQ(sample.linear_acceleration.z(), imu.linear_acceleration.z);
+    }
+}
+
+TEST(ImuSample, sameTypeAsImu)
+{
+    namespace mt = ros::message_traits;
+    EXPECT_STREQ(mt::MD5Sum<ImuSample>::value(), mt::MD5Sum<sensor_msgs::Imu>::value());
+    EXPECT_STREQ(mt::DataType<ImuSample>::value(), mt::DataType<sensor_msgs::Imu>::value());
+}
+
+TEST(ImuSample, truncatedMessageThrows)
+{
+    namespace ser = ros::serialization;
+
+    const auto imu = make_imu("imu_link");
+    std::vector<std::uint8_t> buffer(ser::serializationLength(imu));
+    ser::OStream out{buffer.data(), static_cast<std::uint32_t>(buffer.size())};
+    ser::serialize(out, imu);
+
+    ImuSample sample;
+    ser::IStream in{buffer.data(), static_cast<std::uint32_t>(buffer.size() - 8)};
+    EXPECT_THROW(ser::deserialize(in, sample), ser::StreamOverrunException);
+}
+
+} // namespace pet
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,145 @@
+// Checks that KalmanFilter::process_batch gives the same states and NIS as feeding the same
+// samples one call at a time, and marks imu samples without an update with a NaN NIS.
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ugl/math/vector.h>
+
+#include "kalman_filter.h"
+
+namespace pet
+{
+namespace
+{
+
+constexpr std::size_t kImuCount = 200;
+constexpr double kImuPeriod = 0.01;
+
+// Every fourth imu sample is followed by a sonar observation, and some before the first one.
+constexpr std::size_t kSonarEvery = 4;
+
+struct Recording
+{
+    std::vector<double> stamp;
+    std::vector<double> acc[3];
+    std::vector<double> rate[3];
+
+    std::vector<std::size_t> sonar_index;
+    std::vector<double> sonar_velocity;
+    std::vector<double> sonar_direction;
+    std::vector<double> sonar_variance;
+};
+
+Recording make_recording()
+{
+    Recording recording;
+    for (std::size_t i = 0; i < kImuCount; ++i)
+    {
+        const double t = (i + 1) * kImuPeriod;
+        recording.stamp.push_back(t);
+        recording.acc[0].push_back(0.3 * std::sin(2.0 * t));
+        recording.acc[1].push_back(0.1 * std::cos(3.0 * t));
+        recording.acc[2].push_back(9.81);
+        recording.rate[0].push_back(0.0);
+        recording.rate[1].push_back(0.0);
+        recording.rate[2].push_back(0.2 * std::sin(t));
+    }
+
+    recording.sonar_index.push_back(0);
+    recording.sonar_velocity.push_back(0.05);
+    recording.sonar_direction.push_back(0.0);
+    recording.sonar_variance.push_back(0.02);
+    for (std::size_t i = kSonarEvery; i <= kImuCount; i += kSonarEvery)
+    {
+        recording.sonar_index.push_back(i);
+        recording.sonar_velocity.push_back(0.15 * std::sin(i * kImuPeriod));
+        recording.sonar_direction.push_back((i % 3 == 0) ? 0.3 : 0.0);
+        recording.sonar_variance.push_back(0.01 + 1e-4 * i);
+    }
+    return recording;
+}
+
+KalmanFilter make_filter()
+{
+    return KalmanFilter{0.1, ugl::Vector<2>{1.0, -2.0}, ugl::Vector<2>{0.2, 0.0}};
+}
+
+TEST(KalmanFilterBatch, matchesPerSampleCalls)
+{
+    const Recording recording = make_recording();
+
+    KalmanFilter::ImuBatch imu;
+    imu.size = kImuCount;
+    imu.stamp = recording.stamp.data();
+    imu.acc_x = recording.acc[0].data();
+    imu.acc_y = recording.acc[1].data();
+    imu.acc_z = recording.acc[2].data();
+    imu.rate_x = recording.rate[0].data();
+    imu.rate_y = recording.rate[1].data();
+    imu.rate_z = recording.rate[2].data();
+
+    const KalmanFilter::SonarBatch sonar{recording.sonar_index.size(), recording.sonar_index.data(), recording.sonar_velocity.data(),
+                                         recording.sonar_direction.data(), recording.sonar_variance.data()};
+
+    std::vector<double> states(5 * kImuCount);
+    std::vector<double> nis(kImuCount);
+    KalmanFilter::BatchOutput output;
+    output.states = states.data();
+    output.innovation_nis = nis.data();
+
+    KalmanFilter batch = make_filter();
+    const double end = batch.process_batch(0.0, imu, sonar, output);
+    EXPECT_DOUBLE_EQ(end, recording.stamp.back());
+
+    // The same samples, one call each.
+    KalmanFilter single = make_filter();
+    const auto lateral = KalmanFilter::pseudo_lateral_velocity_observation(0.0);
+    std::size_t next_sonar = 0;
+    const auto apply_sonar = [&](std::size_t predicted) {
+        bool updated = false;
+        for (; next_sonar < recording.sonar_index.size() && recording.sonar_index[next_sonar] <= predicted; ++next_sonar)
+        {
+            single.update(KalmanFilter::sonar_velocity_observation<1>(ugl::Vector<1>::Constant(recording.sonar_velocity[next_sonar]),
+                                                                      ugl::Vector<1>::Constant(recording.sonar_direction[next_sonar]),
+                                                                      ugl::Vector<1>::Constant(recording.sonar_variance[next_sonar])),
+                          lateral);
+            updated = true;
+        }
+        return updated;
+    };
+
+    double previous = 0.0;
+    bool updated = apply_sonar(0);
+    for (std::size_t i = 0; i < kImuCount; ++i)
+    {
+        single.predict(recording.stamp[i] - previous,
+                       ugl::Vector3{recording.acc[0][i], recording.acc[1][i], recording.acc[2][i]},
+                       ugl::Vector3{recording.rate[0][i], recording.rate[1][i], recording.rate[2][i]});
+        previous = recording.stamp[i];
+        updated = apply_sonar(i + 1) || updated;
+
+        EXPECT_NEAR(states[5 * i + 0], single.heading(), 1e-12) << "sample " << i;
+        EXPECT_NEAR(states[5 * i + 1], single.velocity().x(), 1e-12) << "sample " << i;
+        EXPECT_NEAR(states[5 * i + 2], single.velocity().y(), 1e-12) << "sample " << i;
+        EXPECT_NEAR(states[5 * i + 3], single.position().x(), 1e-12) << "sample " << i;
+        EXPECT_NEAR(states[5 * i + 4], single.position().y(), 1e-12) << "sample " << i;
+
+        if (updated) {
+            EXPECT_NEAR(nis[i], single.innovation_nis(), 1e-12) << "sample " << i;
+        }
+        else {
+            EXPECT_TRUE(std::isnan(nis[i])) << "sample " << i;
+        }
+        updated = false;
+    }
+
+    EXPECT_NEAR(batch.heading(), single.heading(), 1e-12);
+    EXPECT_TRUE(batch.covariance().isApprox(single.covariance(), 1e-12));
+}
+
+} // namespace
+} // namespace pet
@@ -0,0 +1,232 @@
+// Guards that KalmanNode's steady-state processing path does not allocate. The heap functions
+// are interposed with counting versions, the node's callbacks and timer are driven directly
+// with synthetic imu and sonar data, and after a warm-up any allocation on the test thread
+// fails the test.
+//
+// Publishing is part of the measured path, but nothing subscribes to the outputs here, so
+// serialisation and transport inside roscpp are not. The node itself only subscribes to
+// /tf_static, never to its own /tf output, which outputsHaveNoSubscribers checks.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <ros/ros.h>
+#include <geometry_msgs/TransformStamped.h>
+#include <tf2_ros/static_transform_broadcaster.h>
+
+#include <pet_mk_iv_msgs/DistanceMeasurement.h>
+
+#include "imu_sample.h"
+#include "testable_kalman_node.h"
+
+// glibc's own allocator, which the interposed functions forward to.
+extern "C" void* __libc_malloc(std::size_t size);
+extern "C" void* __libc_calloc(std::size_t count, std::size_t size);
+extern "C" void* __libc_realloc(void* pointer, std::size_t size);
+extern "C" void* __libc_memalign(std::size_t alignment, std::size_t size);
+extern "C" void __libc_free(void* pointer);
+
+namespace
+{
+
+// Only allocations made by the test thread while counting are of interest, roscpp's own
+// threads keep running in the background.
+thread_local bool t_counting = false;
+thread_local std::uint64_t t_allocations = 0;
+
+void count_allocation()
+{
+    if (t_counting) {
+        ++t_allocations;
+    }
+}
+
+} // namespace
+
+extern "C" void* malloc(std::size_t size)
+{
+    count_allocation();
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(std::size_t count, std::size_t size)
+{
+    count_allocation();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, std::size_t size)
+{
+    count_allocation();
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void* memalign(std::size_t alignment, std::size_t size)
+{
+    count_allocation();
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(std::size_t alignment, std::size_t size)
+{
+    count_allocation();
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** pointer, std::size_t alignment, std::size_t size)
+{
+    count_allocation();
+    *pointer = __libc_memalign(alignment, size);
+    return (*pointer != nullptr) ? 0 : 12; // ENOMEM
+}
+
+extern "C" void free(void* pointer)
+{
+    __libc_free(pointer);
+}
+
+namespace pet
+{
+
+class KalmanNodeTest : public ::testing::Test
+{
+protected:
+    // One timer call of the node, at the default 10 Hz and 100 Hz imu rate.
+    static constexpr int kImuPerCycle = 10;
+    static constexpr double kImuPeriod = 0.01;
+
+    void SetUp() override
+    {
+        m_now = ros::Time{1000.0};
+        ros::Time::setNow(m_now);
+
+        m_node = std::make_unique<TestableKalmanNode>(m_nh, m_nh_private);
+
+        // The sonar has fixed extrinsics, the imu is resolved from TF by the first steps.
+        geometry_msgs::TransformStamped imu_transform;
+        imu_transform.header.stamp = m_now;
+        imu_transform.header.frame_id = "base_link";
+        imu_transform.child_frame_id = "imu_link";
+        imu_transform.transform.rotation.w = 1.0;
+        m_tf_static_broadcaster.sendTransform(imu_transform);
+        ASSERT_TRUE(wait_for_transform("base_link", "imu_link"));
+
+        m_node->start();
+
+        m_imu.linear_acceleration.z() = 9.81;
+
+        m_sonar.header.frame_id = "dist_sensor_mid";
+        m_sonar.distance = 500;
+    }
+
+    void TearDown() override
+    {
+        m_node.reset();
+    }
+
+    // Spins until the node's TF buffer has a transform, false on timeout.
+    bool wait_for_transform(const std::string& target, const std::string& source)
+    {
+        const auto deadline = ros::WallTime::now() + ros::WallDuration{5.0};
+        while (!m_node->tf_buffer().canTransform(target, source, ros::Time{0}))
+        {
+            if (ros::WallTime::now() > deadline) {
+                return false;
+            }
+            ros::spinOnce();
+            ros::WallDuration{0.01}.sleep();
+        }
+        // Delivers the node's own tf_static callback too.
+        ros::spinOnce();
+        return true;
+    }
+
+    // Feeds one timer period worth of measurements to the node and runs its timer callback.
+    void cycle()
+    {
+        for (int i = 0; i < kImuPerCycle; ++i)
+        {
+            m_now += ros::Duration{kImuPeriod};
+            ros::Time::setNow(m_now);
+
+            m_imu.stamp = m_now;
+            m_node->imu_cb(m_imu);
+
+            // Sonars ping at half the imu rate.
+            if (i % 2 == 0)
+            {
+                m_sonar.header.stamp = m_now;
+                m_node->sonar_cb(m_sonar);
+            }
+        }
+
+        ros::TimerEvent event;
+        event.current_expected = m_now;
+        event.current_real = m_now;
+        m_node->timer_cb(event);
+    }
+
+    std::uint32_t output_subscribers() const { return m_node->output_subscribers(); }
+
+    // Runs a number of cycles and returns the number of allocations they made.
+    std::uint64_t count_allocations(int cycles)
+    {
+        t_allocations = 0;
+        t_counting = true;
+        for (int i = 0; i < cycles; ++i) {
+            cycle();
+        }
+        t_counting = false;
+        return t_allocations;
+    }
+
+protected:
+    ros::NodeHandle m_nh{""};
+    ros::NodeHandle m_nh_private{"~"};
+    tf2_ros::StaticTransformBroadcaster m_tf_static_broadcaster;
+    std::unique_ptr<TestableKalmanNode> m_node;
+
+    ros::Time m_now;
+    ImuSample m_imu;
+    pet_mk_iv_msgs::DistanceMeasurement m_sonar;
+};
+
+TEST_F(KalmanNodeTest, allocationsAreCounted)
+{
+    t_allocations = 0;
+    t_counting = true;
+    void* volatile pointer = malloc(16);
+    t_counting = false;
+    free(pointer);
+
+    EXPECT_EQ(t_allocations, 1u);
+}
+
+// A subscriber, even one in this process, would make every publish serialise into a new buffer.
+TEST_F(KalmanNodeTest, outputsHaveNoSubscribers)
+{
+    EXPECT_EQ(output_subscribers(), 0u);
+}
+
+TEST_F(KalmanNodeTest, noAllocationsAfterWarmUp)
+{
+    ASSERT_EQ(output_subscribers(), 0u);
+
+    // Lets the readiness barrier pass and the queue and filter settle.
+    count_allocations(100);
+
+    EXPECT_EQ(count_allocations(5000), 0u);
+}
+
+} // namespace pet
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    ros::init(argc, argv, "kalman_node_allocation_test");
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,138 @@
+// Checks that KalmanNode's measurement queue stays within queue/capacity and sheds the oldest
+// measurements when it overflows, and that measurements which waited for startup do not count as
+// an overload. The node's callbacks and steps are driven directly, the timer never runs.
+
+#include <cstdint>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include <ros/ros.h>
+
+#include <pet_mk_iv_msgs/DistanceMeasurement.h>
+
+#include "imu_sample.h"
+#include "testable_kalman_node.h"
+
+namespace pet
+{
+
+class KalmanNodeTest : public ::testing::Test
+{
+protected:
+    // Matches queue/capacity in kalman_node_queue.test.
+    static constexpr std::size_t kCapacity = 16;
+
+    void SetUp() override
+    {
+        m_now = ros::Time{1000.0};
+        ros::Time::setNow(m_now);
+
+        m_node = std::make_unique<TestableKalmanNode>(m_nh, m_nh_private);
+
+        m_imu.linear_acceleration.z() = 9.81;
+
+        m_sonar.header.frame_id = "dist_sensor_mid";
+        m_sonar.distance = 500;
+    }
+
+    void TearDown() override
+    {
+        m_node.reset();
+    }
+
+    void feed_imu(int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            m_now += ros::Duration{0.01};
+            ros::Time::setNow(m_now);
+            m_imu.stamp = m_now;
+            m_node->imu_cb(m_imu);
+        }
+    }
+
+    void feed_sonar(int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            m_now += ros::Duration{0.01};
+            ros::Time::setNow(m_now);
+            m_sonar.header.stamp = m_now;
+            m_node->sonar_cb(m_sonar);
+        }
+    }
+
+    void wait(double seconds)
+    {
+        m_now += ros::Duration{seconds};
+        ros::Time::setNow(m_now);
+    }
+
+    void begin() { m_node->begin(m_now); }
+    void step() { m_node->step(m_now); }
+
+    std::size_t queue_size() const { return m_node->queue_size(); }
+    const TestableKalmanNode::LoadShedding& load_shedding() const { return m_node->load_shedding(); }
+    bool overloaded() const { return m_node->overloaded(); }
+
+protected:
+    ros::NodeHandle m_nh{""};
+    ros::NodeHandle m_nh_private{"~"};
+    std::unique_ptr<TestableKalmanNode> m_node;
+
+    ros::Time m_now;
+    ImuSample m_imu;
+    pet_mk_iv_msgs::DistanceMeasurement m_sonar;
+};
+
+TEST_F(KalmanNodeTest, queueIsBounded)
+{
+    feed_imu(100);
+
+    EXPECT_EQ(queue_size(), kCapacity);
+    EXPECT_EQ(load_shedding().imu_dropped, 100u - kCapacity);
+    EXPECT_EQ(load_shedding().sonar_dropped, 0u);
+}
+
+TEST_F(KalmanNodeTest, oldestSonarIsDroppedFirst)
+{
+    feed_sonar(4);
+    feed_imu(kCapacity - 4);
+    ASSERT_EQ(queue_size(), kCapacity);
+
+    // Every sonar goes before any imu sample does.
+    feed_imu(4);
+    EXPECT_EQ(queue_size(), kCapacity);
+    EXPECT_EQ(load_shedding().sonar_dropped, 4u);
+    EXPECT_EQ(load_shedding().imu_dropped, 0u);
+
+    feed_imu(10);
+    EXPECT_EQ(queue_size(), kCapacity);
+    EXPECT_EQ(load_shedding().imu_dropped, 10u);
+}
+
+TEST_F(KalmanNodeTest, staleMeasurementsAreDroppedOnStart)
+{
+    begin();
+
+    // Imu data, then a gap longer than queue/max_latency before the sonar reports and the
+    // barrier releases.
+    feed_imu(8);
+    wait(0.5);
+    feed_imu(5);
+    feed_sonar(1);
+    ASSERT_EQ(queue_size(), 14u);
+
+    step();
+    EXPECT_FALSE(overloaded());
+}
+
+} // namespace pet
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    ros::init(argc, argv, "kalman_node_queue_test");
+    return RUN_ALL_TESTS();
+}
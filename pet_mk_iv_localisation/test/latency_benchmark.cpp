@@ -0,0 +1,350 @@
+// End-to-end latency benchmark of the localisation node, run through rostest. Publishes
+// synthetic imu and sonar data at a high rate and timestamps the pose_filtered and TF outputs
+// it gets back. An imu message counts as delivered by the first output made after the node
+// has processed it, i.e. whose stamp minus the node's queue/min_latency has passed it.
+//
+// Reports p50/p99/max latency of both outputs and the CPU usage of the node under test.
+//
+// Parameters (private):
+//   target_node  Name of the node under test, for its CPU usage.
+//   mode         Label of the configuration under test in the report.
+//   duration     Length of the measurement [s], after warm_up [s].
+//   imu_rate, sonar_rate  Publish rates [Hz].
+//   min_latency  queue/min_latency of the node under test [s].
+//   base_frame   Child frame of the node's TF output.
+//   max_p99      If positive, the test fails when the p99 pose latency exceeds it [s].
+//   output       If set, a CSV line with the results is appended to this file.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <ros/ros.h>
+#include <ros/master.h>
+#include <ros/network.h>
+#include <xmlrpcpp/XmlRpcClient.h>
+
+#include <geometry_msgs/PoseStamped.h>
+#include <pet_mk_iv_msgs/DistanceMeasurement.h>
+#include <sensor_msgs/Imu.h>
+#include <tf2_msgs/TFMessage.h>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+struct Published
+{
+    ros::Time stamp;
+    Clock::time_point time;
+};
+
+// Latencies of one output, matched against the published imu messages.
+class OutputLatency
+{
+public:
+    explicit OutputLatency(const ros::Duration& min_latency)
+        : m_min_latency(min_latency)
+    {
+    }
+
+    void add(const std::vector<Published>& published, const ros::Time& output_stamp, Clock::time_point received)
+    {
+        const ros::Time horizon = output_stamp - m_min_latency;
+        for (; m_next < published.size() && published[m_next].stamp <= horizon; ++m_next)
+        {
+            if (m_recording) {
+                m_latencies.push_back(std::chrono::duration<double>(received - published[m_next].time).count());
+            }
+        }
+    }
+
+    void set_recording(bool recording)
+    {
+        m_recording = recording;
+    }
+
+    std::size_t count() const
+    {
+        return m_latencies.size();
+    }
+
+    // Latency at quantile q of the recorded ones [s].
+    double quantile(double q)
+    {
+        if (m_latencies.empty()) {
+            return 0.0;
+        }
+        const auto nth = m_latencies.begin() + static_cast<long>(q * (m_latencies.size() - 1));
+        std::nth_element(m_latencies.begin(), nth, m_latencies.end());
+        return *nth;
+    }
+
+private:
+    const ros::Duration m_min_latency;
+    std::size_t m_next = 0;
+    bool m_recording = false;
+    std::vector<double> m_latencies;
+};
+
+// Process id of a ROS node, asked from the node itself.
+int lookup_pid(const std::string& node_name)
+{
+    XmlRpc::XmlRpcValue request;
+    XmlRpc::XmlRpcValue response;
+    XmlRpc::XmlRpcValue payload;
+    request[0] = ros::this_node::getName();
+    request[1] = node_name;
+    if (!ros::master::execute("lookupNode", request, response, payload, true)) {
+        return -1;
+    }
+
+    std::string host;
+    uint32_t port = 0;
+    if (!ros::network::splitURI(static_cast<std::string>(payload), host, port)) {
+        return -1;
+    }
+
+    XmlRpc::XmlRpcClient client{host.c_str(), static_cast<int>(port), "/"};
+    XmlRpc::XmlRpcValue pid_request;
+    XmlRpc::XmlRpcValue pid_response;
+    pid_request[0] = ros::this_node::getName();
+    if (!client.execute("getPid", pid_request, pid_response) || pid_response.size() < 3) {
+        return -1;
+    }
+    return static_cast<int>(pid_response[2]);
+}
+
+// User plus system CPU time used by a process [s].
+double cpu_time(int pid)
+{
+    std::ifstream stat{"/proc/" + std::to_string(pid) + "/stat"};
+    std::string line;
+    std::getline(stat, line);
+
+    // Fields after the command name, which may contain spaces, start at the last ')'.
+    const auto end_of_name = line.rfind(')');
+    if (end_of_name == std::string::npos) {
+        return 0.0;
+    }
+
+    std::istringstream fields{line.substr(end_of_name + 2)};
+    std::string field;
+    unsigned long utime = 0;
+    unsigned long stime = 0;
+    // State is field 3, utime and stime are fields 14 and 15.
+    for (int i = 3; i < 14; ++i) {
+        fields >> field;
+    }
+    fields >> utime >> stime;
+    return static_cast<double>(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+class LatencyBenchmark
+{
+public:
+    LatencyBenchmark()
+        : m_nh("")
+        , m_nh_private("~")
+        , m_imu_rate(m_nh_private.param<double>("imu_rate", 200.0))
+        , m_sonar_rate(m_nh_private.param<double>("sonar_rate", 20.0))
+        , m_base_frame(m_nh_private.param<std::string>("base_frame", "base_link"))
+        , m_pose_latency(ros::Duration{m_nh_private.param<double>("min_latency", 0.005)})
+        , m_tf_latency(ros::Duration{m_nh_private.param<double>("min_latency", 0.005)})
+    {
+        m_imu_pub = m_nh.advertise<sensor_msgs::Imu>("imu", 100);
+        m_sonar_pub = m_nh.advertise<pet_mk_iv_msgs::DistanceMeasurement>("dist_sensors", 100);
+        m_pose_sub = m_nh.subscribe("pose_filtered", 100, &LatencyBenchmark::pose_cb, this, ros::TransportHints().tcpNoDelay());
+        m_tf_sub = m_nh.subscribe("/tf", 100, &LatencyBenchmark::tf_cb, this, ros::TransportHints().tcpNoDelay());
+    }
+
+    void run()
+    {
+        const std::string target_node = m_nh_private.param<std::string>("target_node", "kalman_node");
+        const double warm_up = m_nh_private.param<double>("warm_up", 3.0);
+        const double duration = m_nh_private.param<double>("duration", 10.0);
+
+        // Wait for the node under test to connect before publishing anything.
+        const auto connect_deadline = Clock::now() + std::chrono::seconds{30};
+        while (ros::ok() && (m_imu_pub.getNumSubscribers() == 0 || m_sonar_pub.getNumSubscribers() == 0) && Clock::now() < connect_deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{100});
+        }
+
+        const int pid = lookup_pid(ros::names::resolve(target_node));
+        if (pid < 0) {
+            ROS_WARN("Could not find process of node [%s], CPU usage is not measured.", target_node.c_str());
+        }
+
+        std::atomic<bool> publishing{true};
+        std::thread publisher{[this, &publishing]{ publish_loop(publishing); }};
+
+        std::this_thread::sleep_for(std::chrono::duration<double>{warm_up});
+        set_recording(true);
+        const double cpu_start = (pid > 0) ? cpu_time(pid) : 0.0;
+        const auto start = Clock::now();
+
+        std::this_thread::sleep_for(std::chrono::duration<double>{duration});
+
+        set_recording(false);
+        const double cpu_used = (pid > 0) ? cpu_time(pid) - cpu_start : 0.0;
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+        publishing = false;
+        publisher.join();
+
+        m_cpu_usage = cpu_used / elapsed;
+    }
+
+    void report()
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        const std::string mode = m_nh_private.param<std::string>("mode", "timer");
+
+        ROS_INFO("Latency benchmark [%s] at %.0f Hz imu, %.0f Hz sonar:", mode.c_str(), m_imu_rate, m_sonar_rate);
+        ROS_INFO("  pose_filtered: n=%zu p50=%.3f ms p99=%.3f ms max=%.3f ms", m_pose_latency.count(),
+                 m_pose_latency.quantile(0.5) * 1e3, m_pose_latency.quantile(0.99) * 1e3, m_pose_latency.quantile(1.0) * 1e3);
+        ROS_INFO("  tf:            n=%zu p50=%.3f ms p99=%.3f ms max=%.3f ms", m_tf_latency.count(),
+                 m_tf_latency.quantile(0.5) * 1e3, m_tf_latency.quantile(0.99) * 1e3, m_tf_latency.quantile(1.0) * 1e3);
+        ROS_INFO("  cpu: %.1f %%", m_cpu_usage * 100.0);
+
+        const std::string output = m_nh_private.param<std::string>("output", "");
+        if (!output.empty())
+        {
+            std::ofstream file{output, std::ios::app};
+            file << mode << ',' << m_imu_rate << ',' << m_sonar_rate << ','
+                 << m_pose_latency.quantile(0.5) << ',' << m_pose_latency.quantile(0.99) << ',' << m_pose_latency.quantile(1.0) << ','
+                 << m_tf_latency.quantile(0.5) << ',' << m_tf_latency.quantile(0.99) << ',' << m_tf_latency.quantile(1.0) << ','
+                 << m_cpu_usage << '\n';
+        }
+    }
+
+    std::size_t pose_count()
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_pose_latency.count();
+    }
+
+    double pose_p99()
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_pose_latency.quantile(0.99);
+    }
+
+private:
+    void publish_loop(const std::atomic<bool>& publishing)
+    {
+        const auto imu_period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{1.0 / m_imu_rate});
+        const int imu_per_sonar = std::max(1, static_cast<int>(m_imu_rate / m_sonar_rate));
+
+        sensor_msgs::Imu imu;
+        imu.header.frame_id = "imu_link";
+        imu.linear_acceleration.z = 9.81;
+
+        pet_mk_iv_msgs::DistanceMeasurement sonar;
+        sonar.header.frame_id = "dist_sensor_mid";
+        sonar.distance = 500;
+
+        auto next = Clock::now();
+        for (int i = 0; publishing; ++i)
+        {
+            std::this_thread::sleep_until(next);
+            next += imu_period;
+
+            imu.header.stamp = ros::Time::now();
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                m_published.push_back({imu.header.stamp, Clock::now()});
+            }
+            m_imu_pub.publish(imu);
+
+            if (i % imu_per_sonar == 0)
+            {
+                sonar.header.stamp = imu.header.stamp;
+                m_sonar_pub.publish(sonar);
+            }
+        }
+    }
+
+    void set_recording(bool recording)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_pose_latency.set_recording(recording);
+        m_tf_latency.set_recording(recording);
+    }
+
+    void pose_cb(const geometry_msgs::PoseStamped& msg)
+    {
+        const auto received = Clock::now();
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_pose_latency.add(m_published, msg.header.stamp, received);
+    }
+
+    void tf_cb(const tf2_msgs::TFMessage& msg)
+    {
+        const auto received = Clock::now();
+        std::lock_guard<std::mutex> lock{m_mutex};
+        for (const auto& transform : msg.transforms)
+        {
+            if (transform.child_frame_id == m_base_frame) {
+                m_tf_latency.add(m_published, transform.header.stamp, received);
+            }
+        }
+    }
+
+private:
+    ros::NodeHandle m_nh;
+    ros::NodeHandle m_nh_private;
+
+    ros::Publisher m_imu_pub;
+    ros::Publisher m_sonar_pub;
+    ros::Subscriber m_pose_sub;
+    ros::Subscriber m_tf_sub;
+
+    const double m_imu_rate;
+    const double m_sonar_rate;
+    const std::string m_base_frame;
+
+    std::mutex m_mutex;
+    std::vector<Published> m_published;
+    OutputLatency m_pose_latency;
+    OutputLatency m_tf_latency;
+    double m_cpu_usage = 0.0;
+};
+
+} // namespace
+
+TEST(LatencyBenchmark, endToEnd)
+{
+    ros::AsyncSpinner spinner{2};
+    spinner.start();
+
+    LatencyBenchmark benchmark;
+    benchmark.run();
+    benchmark.report();
+
+    EXPECT_GT(benchmark.pose_count(), 0u);
+
+    const double max_p99 = ros::NodeHandle{"~"}.param<double>("max_p99", 0.0);
+    if (max_p99 > 0.0) {
+        EXPECT_LE(benchmark.pose_p99(), max_p99);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    ros::init(argc, argv, "latency_benchmark");
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,108 @@
+// Checks the seqlock of the pose channel: with a writer thread publishing as fast as it can, a
+// reader never sees a torn sample. Every word of a written sample holds the same counter.
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "pose_channel_reader.h"
+#include "pose_channel_writer.h"
+
+namespace pet
+{
+namespace
+{
+
+constexpr std::int64_t kWrites = 2000000;
+
+PoseSample make_sample(std::int64_t counter)
+{
+    // Exactly representable, so that every field compares equal to the counter.
+    const auto value = static_cast<double>(counter);
+    return PoseSample{counter, value, value, value, value, value};
+}
+
+bool is_consistent(const PoseSample& sample)
+{
+    const auto value = static_cast<double>(sample.stamp);
+    return sample.heading == value && sample.velocity_x == value && sample.velocity_y == value
+        && sample.position_x == value && sample.position_y == value;
+}
+
+class PoseChannelTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_TRUE(m_writer.open(m_name));
+        ASSERT_TRUE(m_reader.open(m_name)) << m_reader.error();
+    }
+
+    void TearDown() override
+    {
+        m_reader.close();
+        m_writer.close();
+        shm_unlink(m_name.c_str());
+    }
+
+protected:
+    const std::string m_name = "/pet_pose_channel_test_" + std::to_string(getpid());
+    PoseChannelWriter m_writer;
+    PoseChannelReader m_reader;
+};
+
+TEST_F(PoseChannelTest, nothingReadBeforeFirstWrite)
+{
+    PoseSample sample;
+    EXPECT_FALSE(m_reader.read(sample));
+}
+
+TEST_F(PoseChannelTest, samplesAreNeverTorn)
+{
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        for (std::int64_t i = 1; i <= kWrites; ++i) {
+            m_writer.write(make_sample(i));
+        }
+        done = true;
+    });
+
+    std::int64_t reads = 0;
+    std::int64_t torn = 0;
+    std::int64_t previous = 0;
+    std::int64_t backwards = 0;
+    while (!done)
+    {
+        PoseSample sample;
+        if (!m_reader.read(sample)) {
+            continue;
+        }
+        ++reads;
+        if (!is_consistent(sample)) {
+            ++torn;
+        }
+        if (sample.stamp < previous) {
+            ++backwards;
+        }
+        previous = sample.stamp;
+    }
+    writer.join();
+
+    EXPECT_GT(reads, 0);
+    EXPECT_EQ(torn, 0);
+    EXPECT_EQ(backwards, 0);
+
+    PoseSample last;
+    ASSERT_TRUE(m_reader.read(last));
+    EXPECT_EQ(last.stamp, kWrites);
+    EXPECT_TRUE(is_consistent(last));
+}
+
+} // namespace
+} // namespace pet
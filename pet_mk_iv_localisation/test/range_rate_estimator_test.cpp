@@ -0,0 +1,167 @@
+// Checks that RangeRateEstimator fits the exact slope of a noiseless ramp, keeps its running sums
+// in agreement with a fit from scratch over many laps of the window, and starts over on reset().
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ros/time.h>
+
+#include "range_rate_estimator.h"
+
+namespace pet
+{
+namespace
+{
+
+constexpr double kPeriod = 0.05;
+constexpr double kStart = 1.6e9;
+
+// Matches RangeRateEstimator::kMinVariance.
+constexpr double kMinVariance = 1e-4;
+
+ros::Time stamp(int i)
+{
+    return ros::Time{kStart} + ros::Duration{i * kPeriod};
+}
+
+// Least squares slope and its variance over the given samples, computed from scratch.
+struct Fit
+{
+    double rate;
+    double variance;
+};
+
+Fit fit(const std::vector<ros::Time>& stamps, const std::vector<double>& ranges)
+{
+    const double n = static_cast<double>(stamps.size());
+    double mean_t = 0.0;
+    double mean_r = 0.0;
+    for (std::size_t i = 0; i < stamps.size(); ++i)
+    {
+        mean_t += (stamps[i] - stamps.front()).toSec() / n;
+        mean_r += ranges[i] / n;
+    }
+
+    double s_tt = 0.0;
+    double s_tr = 0.0;
+    for (std::size_t i = 0; i < stamps.size(); ++i)
+    {
+        const double t = (stamps[i] - stamps.front()).toSec() - mean_t;
+        s_tt += t * t;
+        s_tr += t * (ranges[i] - mean_r);
+    }
+    const double rate = s_tr / s_tt;
+
+    double residual = 0.0;
+    for (std::size_t i = 0; i < stamps.size(); ++i)
+    {
+        const double t = (stamps[i] - stamps.front()).toSec() - mean_t;
+        const double error = ranges[i] - mean_r - rate * t;
+        residual += error * error;
+    }
+    return Fit{rate, std::max(residual / (n - 2.0) / s_tt, kMinVariance)};
+}
+
+// Range noise in [-amplitude, amplitude], from a fixed seed so that failures can be reproduced.
+class Noise
+{
+public:
+    explicit Noise(double amplitude)
+        : m_amplitude(amplitude)
+    {
+    }
+
+    double next()
+    {
+        m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return m_amplitude * (2.0 * static_cast<double>(m_state >> 11) / static_cast<double>(1ULL << 53) - 1.0);
+    }
+
+private:
+    double m_amplitude;
+    std::uint64_t m_state = 1;
+};
+
+TEST(RangeRateEstimator, noiselessRampGivesExactRate)
+{
+    RangeRateEstimator estimator{5};
+
+    estimator.add(stamp(0), 2.0);
+    estimator.add(stamp(1), 2.0 - 0.3 * kPeriod);
+    EXPECT_FALSE(estimator.has_estimate());
+
+    for (int i = 2; i < 12; ++i)
+    {
+        estimator.add(stamp(i), 2.0 - 0.3 * i * kPeriod);
+        ASSERT_TRUE(estimator.has_estimate());
+        EXPECT_NEAR(estimator.rate(), -0.3, 1e-9);
+        EXPECT_DOUBLE_EQ(estimator.variance(), kMinVariance);
+    }
+}
+
+TEST(RangeRateEstimator, sumsStayAccurateOverManyLaps)
+{
+    for (const int window : {3, 5, RangeRateEstimator::kMaxWindowSize})
+    {
+        RangeRateEstimator estimator{window};
+        Noise noise{0.02};
+        std::vector<ros::Time> stamps;
+        std::vector<double> ranges;
+
+        // Many laps of the window, at stamps far from zero and with noise large enough to keep
+        // the variance above its minimum.
+        for (int i = 0; i < 50 * window + 3; ++i)
+        {
+            stamps.push_back(stamp(i));
+            ranges.push_back(1.5 + 0.4 * std::sin(0.1 * i) + noise.next());
+            estimator.add(stamps.back(), ranges.back());
+        }
+
+        const std::vector<ros::Time> last_stamps(stamps.end() - window, stamps.end());
+        const std::vector<double> last_ranges(ranges.end() - window, ranges.end());
+        const Fit expected = fit(last_stamps, last_ranges);
+
+        ASSERT_TRUE(estimator.has_estimate());
+        EXPECT_NEAR(estimator.rate(), expected.rate, 1e-9) << "window " << window;
+        EXPECT_NEAR(estimator.variance(), expected.variance, 1e-9 * expected.variance) << "window " << window;
+    }
+}
+
+TEST(RangeRateEstimator, resetStartsOver)
+{
+    RangeRateEstimator estimator{5};
+    for (int i = 0; i < 7; ++i) {
+        estimator.add(stamp(i), 2.0 - 0.3 * i * kPeriod);
+    }
+    ASSERT_TRUE(estimator.has_estimate());
+
+    estimator.reset();
+    EXPECT_FALSE(estimator.has_estimate());
+    EXPECT_EQ(estimator.rate(), 0.0);
+    EXPECT_EQ(estimator.variance(), 0.0);
+
+    // After a gap, and with none of the samples from before the reset in the fit.
+    estimator.add(stamp(100), 1.0);
+    estimator.add(stamp(101), 1.0 + 0.5 * kPeriod);
+    EXPECT_FALSE(estimator.has_estimate());
+
+    estimator.add(stamp(102), 1.0 + 1.0 * kPeriod);
+    ASSERT_TRUE(estimator.has_estimate());
+    EXPECT_NEAR(estimator.rate(), 0.5, 1e-9);
+}
+
+TEST(RangeRateEstimator, simultaneousSamplesGiveNoEstimate)
+{
+    RangeRateEstimator estimator{5};
+    for (int i = 0; i < 4; ++i) {
+        estimator.add(stamp(0), 2.0 + 0.01 * i);
+    }
+    EXPECT_FALSE(estimator.has_estimate());
+}
+
+} // namespace
+} // namespace pet
@@ -0,0 +1,65 @@
+"""Checks run() of the Python bindings, which goes through KalmanFilter::process_batch, against
+the per-sample bindings and against a sonar recording with a known range rate.
+
+Needs the kalman_filter_python module in the devel space, which catkin_add_nosetests provides.
+"""
+
+import unittest
+
+import numpy as np
+
+from pet_mk_iv_localisation.kalman_filter import KalmanFilter, run
+
+IMU_PERIOD = 0.01
+IMU_COUNT = 200
+
+
+def make_imu():
+    stamps = IMU_PERIOD * np.arange(1, IMU_COUNT + 1)
+    acc = np.column_stack([0.3 * np.sin(2.0 * stamps), 0.1 * np.cos(3.0 * stamps), np.full(IMU_COUNT, 9.81)])
+    rate = np.column_stack([np.zeros(IMU_COUNT), np.zeros(IMU_COUNT), 0.2 * np.sin(stamps)])
+    return stamps, acc, rate
+
+
+class TestRun(unittest.TestCase):
+
+    def test_matches_predict_without_sonar(self):
+        stamps, acc, rate = make_imu()
+
+        batch = KalmanFilter(0.1, [1.0, -1.0], [0.2, 0.0])
+        out_stamps, states = run(batch, stamps, acc, rate, np.empty(0), np.empty(0))
+
+        single = KalmanFilter(0.1, [1.0, -1.0], [0.2, 0.0])
+        previous = stamps[0]
+        for i, stamp in enumerate(stamps):
+            if stamp > previous:
+                single.predict(stamp - previous, acc[i], rate[i])
+                previous = stamp
+            expected = np.concatenate([[single.heading], single.velocity, single.position])
+            np.testing.assert_allclose(states[i], expected, rtol=1e-12, atol=1e-12)
+
+        np.testing.assert_array_equal(out_stamps, stamps)
+        np.testing.assert_allclose(batch.covariance, single.covariance, rtol=1e-12, atol=1e-12)
+
+    def test_sonar_range_rate_gives_velocity(self):
+        # Standing still according to the imu, while the sonar sees a wall ahead approach at 0.2 m/s.
+        stamps = IMU_PERIOD * np.arange(1, IMU_COUNT + 1)
+        zeros = np.zeros((IMU_COUNT, 3))
+        sonar_stamps = np.arange(0.05, stamps[-1], 0.05)
+        sonar_distances = 2.0 - 0.2 * sonar_stamps
+
+        kf = KalmanFilter(0.0, [0.0, 0.0], [0.0, 0.0])
+        _, states = run(kf, stamps, zeros, zeros, sonar_stamps, sonar_distances)
+
+        self.assertEqual(states.shape, (IMU_COUNT, 5))
+        self.assertAlmostEqual(states[-1, 1], 0.2, delta=0.02)
+        self.assertAlmostEqual(states[-1, 2], 0.0, delta=0.02)
+
+    def test_rejects_mismatched_shapes(self):
+        stamps, acc, rate = make_imu()
+        with self.assertRaises(ValueError):
+            run(KalmanFilter(), stamps, acc[:-1], rate, np.empty(0), np.empty(0))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,32 @@
+#ifndef PET_LOCALISATION_TESTABLE_KALMAN_NODE_H
+#define PET_LOCALISATION_TESTABLE_KALMAN_NODE_H
+
+#include "kalman_node.h"
+
+namespace pet
+{
+
+// KalmanNode with its processing entry points and state made public, so that tests can feed
+// measurements and run steps directly instead of through subscribers and the timer.
+class TestableKalmanNode : public KalmanNode
+{
+public:
+    using KalmanNode::KalmanNode;
+
+    using KalmanNode::begin;
+    using KalmanNode::step;
+    using KalmanNode::timer_cb;
+    using KalmanNode::imu_cb;
+    using KalmanNode::sonar_cb;
+
+    using KalmanNode::LoadShedding;
+    using KalmanNode::queue_size;
+    using KalmanNode::load_shedding;
+    using KalmanNode::overloaded;
+    using KalmanNode::tf_buffer;
+    using KalmanNode::output_subscribers;
+};
+
+} // namespace pet
+
+#endif // PET_LOCALISATION_TESTABLE_KALMAN_NODE_H